@@ -0,0 +1,87 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#define ARENA_IMPLEMENTATION
+#include "arena.h"
+
+#ifndef BUILD_RELEASE
+static atomic_size_t heapAllocs; // the line index allocates from worker threads
+
+size_t arena_heap_allocs(void)
+{
+    return atomic_load(&heapAllocs);
+}
+
+void *arena_counted_malloc(size_t n)
+{
+    atomic_fetch_add(&heapAllocs, 1);
+    return malloc(n);
+}
+
+void *arena_counted_realloc(void *ptr, size_t n)
+{
+    atomic_fetch_add(&heapAllocs, 1);
+    return realloc(ptr, n);
+}
+#endif
+
+static ArenaBlock *arena_block_new(ArenaBlock *prev, size_t size)
+{
+#ifndef BUILD_RELEASE
+    atomic_fetch_add(&heapAllocs, 1);
+#endif
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + size);
+    assert(block != NULL);
+    block->prev = prev;
+    block->size = size;
+    block->count = 0;
+    return block;
+}
+
+void arena_init(Arena *a, size_t size)
+{
+    a->block = arena_block_new(NULL, size);
+}
+
+void arena_free(Arena *a)
+{
+    while (a->block != NULL)
+    {
+        ArenaBlock *prev = a->block->prev;
+        free(a->block);
+        a->block = prev;
+    }
+}
+
+void *arena_alloc(Arena *a, size_t n)
+{
+    const size_t align = _Alignof(max_align_t);
+    n = (n + align - 1) / align * align;
+
+    ArenaBlock *block = a->block;
+    if (block == NULL || block->size - block->count < n)
+    {
+        // never realloc: earlier allocations of this frame point into the block
+        size_t size = block != NULL ? block->size * 2 : 0;
+        if (size < n) size = n;
+        block = a->block = arena_block_new(block, size);
+    }
+    void *ptr = block->items + block->count;
+    block->count += n;
+    return ptr;
+}
+
+void arena_reset(Arena *a)
+{
+    ArenaBlock *block = a->block;
+    if (block == NULL) return;
+
+    if (block->prev != NULL)
+    {   // the frame did not fit, replace the blocks by one that holds all of it
+        size_t size = 0;
+        for (ArenaBlock *b = block; b != NULL; b = b->prev) size += b->size;
+        arena_free(a);
+        block = a->block = arena_block_new(NULL, size);
+    }
+    block->count = 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+/*
+ * Frame arena
+ *
+ * Bump allocator for memory that only has to live until the next frame
+ * (scratch strings, text handed to the clipboard, ...). arena_reset() gives
+ * everything back at once. When a frame needs more than the arena holds,
+ * extra blocks are chained on and merged into one big enough block at the
+ * next reset, so after warming up a frame never touches the heap.
+ *
+ * Debug builds also count the malloc/realloc calls of every file including
+ * this header (after the libc headers), so the editor can check that a
+ * frame which did not edit anything did not allocate either.
+ */
+#include <stddef.h>
+
+typedef struct ArenaBlock ArenaBlock;
+struct ArenaBlock {
+    ArenaBlock *prev;
+    size_t      size;
+    size_t      count;
+    _Alignas(max_align_t) char items[];
+};
+
+typedef struct {
+    ArenaBlock *block; // newest block, older ones (this frame only) linked through prev
+} Arena;
+
+void   arena_init(Arena *a, size_t size);
+void   arena_free(Arena *a);
+
+// returns `n` bytes aligned for any type, valid until arena_reset()
+void  *arena_alloc(Arena *a, size_t n);
+void   arena_reset(Arena *a);
+
+#ifndef BUILD_RELEASE
+// number of malloc/realloc calls made so far by the counted files
+size_t arena_heap_allocs(void);
+
+void  *arena_counted_malloc(size_t n);
+void  *arena_counted_realloc(void *ptr, size_t n);
+
+#ifndef ARENA_IMPLEMENTATION
+#define malloc(n)       arena_counted_malloc(n)
+#define realloc(ptr, n) arena_counted_realloc(ptr, n)
+#endif
+#endif
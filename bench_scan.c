@@ -0,0 +1,127 @@
+// microbenchmark of the newline scanners, built and ran with `make bench`
+//
+// scan.c is included so the scalar, SSE2 and AVX2 implementations can be
+// timed side by side, not just the one picked at startup
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "scan.c"
+
+#define BENCH_BYTES  (256 << 20)
+#define BENCH_ROUNDS 5
+
+typedef struct {
+    const char *name;
+    size_t (*newline)(const char *, size_t);
+    size_t (*count)(const char *, size_t);
+    bool supported;
+} Impl;
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// lines of `length` bytes, '\n' included
+static void fill(char *text, size_t n, size_t length)
+{
+    for (size_t i=0; i<n; i++)
+        text[i] = (i + 1) % length == 0 ? '\n' : 'a' + i % 26;
+}
+
+// best of BENCH_ROUNDS, in GB/s. The sum of the offsets is checked against
+// the scalar one so the calls do not get optimized away
+static double time_newline(const Impl *impl, const char *text, size_t n, size_t *sum)
+{
+    double best = 1e9;
+    for (int r=0; r<BENCH_ROUNDS; r++)
+    {
+        const double start = now();
+        size_t total = 0;
+        for (size_t i=0; i<n;)
+        {
+            const size_t at = impl->newline(text + i, n - i);
+            total += at;
+            i += at + 1;
+        }
+        const double seconds = now() - start;
+        if (seconds < best) best = seconds;
+        *sum = total;
+    }
+    return n/best/1e9;
+}
+
+static double time_count(const Impl *impl, const char *text, size_t n, size_t *sum)
+{
+    double best = 1e9;
+    for (int r=0; r<BENCH_ROUNDS; r++)
+    {
+        const double start = now();
+        *sum = impl->count(text, n);
+        const double seconds = now() - start;
+        if (seconds < best) best = seconds;
+    }
+    return n/best/1e9;
+}
+
+int main(void)
+{
+    Impl impls[] = {
+        { "scalar", scan_newline_scalar, scan_count_newlines_scalar, true },
+#ifdef SCAN_X86
+        { "sse2", scan_newline_sse2, scan_count_newlines_sse2, __builtin_cpu_supports("sse2") },
+        { "avx2", scan_newline_avx2, scan_count_newlines_avx2, __builtin_cpu_supports("avx2") },
+#endif
+    };
+    const size_t implCount = sizeof(impls)/sizeof(impls[0]);
+    const size_t lengths[] = { 16, 80, 2048 };
+
+    char *text = malloc(BENCH_BYTES);
+    if (text == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    printf("%zu MB, best of %d, GB/s\n", (size_t)BENCH_BYTES >> 20, BENCH_ROUNDS);
+    printf("%-8s %-14s", "line", "function");
+    for (size_t k=0; k<implCount; k++) printf(" %8s", impls[k].name);
+    printf("\n");
+
+    bool ok = true;
+    for (size_t l=0; l<sizeof(lengths)/sizeof(lengths[0]); l++)
+    {
+        fill(text, BENCH_BYTES, lengths[l]);
+        for (int f=0; f<2; f++)
+        {
+            printf("%-8zu %-14s", lengths[l], f == 0 ? "newline" : "count_newlines");
+            size_t expected = 0;
+            for (size_t k=0; k<implCount; k++)
+            {
+                if (!impls[k].supported)
+                {
+                    printf(" %8s", "-");
+                    continue;
+                }
+                size_t sum = 0;
+                const double rate = f == 0 ? time_newline(&impls[k], text, BENCH_BYTES, &sum)
+                                           : time_count(&impls[k], text, BENCH_BYTES, &sum);
+                if (k == 0) expected = sum;
+                else if (sum != expected) ok = false;
+                printf(" %8.2f", rate);
+            }
+            printf("\n");
+        }
+    }
+
+    free(text);
+    if (!ok)
+    {
+        fprintf(stderr, "implementations disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,353 @@
+// benchmark of the text functions of the raylib copy in raylib/, built and
+// ran with `make bench`
+//
+// the editor links the prebuilt lib/libraylib.a, this links raylib/src built
+// from source instead, so its changes can be measured against the code they
+// replaced. Drawing goes into an offscreen framebuffer of an EGL context, so
+// no window (or display) is needed
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "raylib.h"
+#include "rlgl.h"
+
+#define BENCH_SECONDS 0.2
+#define BENCH_ROUNDS  5
+#define BENCH_FONTS   8 // loaded besides the one that is looked up in
+#define BENCH_WIDTH   1280
+#define BENCH_HEIGHT  720
+#define BENCH_FRAMES  20
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// what rlGetGlyphIndex() did before it had a lookup table
+static int glyph_index_linear(rlFont font, int codepoint)
+{
+    int fallbackIndex = 0;
+    for (int i = 0; i < font.glyphCount; i++)
+    {
+        if (font.glyphs[i].value == 63) fallbackIndex = i;
+        if (font.glyphs[i].value == codepoint) return i;
+    }
+    return fallbackIndex;
+}
+
+// glyphs for ' '..'~' and `extra` codepoints from `first` on, without an
+// atlas, only the glyph values matter for the lookup
+static rlFont font_make(int extra, int first)
+{
+    rlFont font = { 0 };
+    font.glyphCount = 95 + extra;
+    font.glyphs = RL_CALLOC(font.glyphCount, sizeof(rlGlyphInfo));
+    for (int i = 0; i < font.glyphCount; i++)
+        font.glyphs[i].value = i < 95 ? 32 + i : first + i - 95;
+    return font;
+}
+
+// nanoseconds per lookup, best of BENCH_ROUNDS of BENCH_SECONDS each. The
+// indices are summed up over one pass of `codepoints` and compared, so the
+// calls do not get optimized away
+static double time_lookups(int (*lookup)(rlFont, int), rlFont font, const int *codepoints, int count, long *sum)
+{
+    double best = 1e9;
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        const double start = now();
+        double seconds = 0;
+        long lookups = 0;
+        while (seconds < BENCH_SECONDS)
+        {
+            long total = 0;
+            for (int i = 0; i < count; i++) total += lookup(font, codepoints[i]);
+            *sum = total;
+            lookups += count;
+            seconds = now() - start;
+        }
+        if (seconds/lookups < best) best = seconds/lookups;
+    }
+    return best*1e9;
+}
+
+static bool bench_lookup(void)
+{
+    // other fonts are loaded too, the table of the one drawn with still has
+    // to be found right away
+    rlFont others[BENCH_FONTS];
+    for (int i = 0; i < BENCH_FONTS; i++)
+    {
+        others[i] = font_make(0, 0);
+        rlGetGlyphIndex(others[i], 'a');
+    }
+
+    struct {
+        const char *name;
+        int extra;      // glyphs past ascii
+        int first;      // first codepoint of them
+        int textFirst;  // codepoints looked up
+        int textCount;
+    } cases[] = {
+        { "ascii font, ascii text", 0, 0, 32, 95 },
+        { "latin font, ascii text", 160, 160, 32, 95 },
+        { "cjk font, ascii text", 8000, 0x4e00, 32, 95 },
+        { "cjk font, cjk text", 8000, 0x4e00, 0x4e00, 8000 },
+    };
+
+    bool ok = true;
+    const int count = 4096;
+    int *codepoints = malloc(count*sizeof(int));
+    printf("%-24s %10s %10s\n", "glyph lookup, ns", "linear", "table");
+    for (size_t c = 0; c < sizeof(cases)/sizeof(cases[0]); c++)
+    {
+        rlFont font = font_make(cases[c].extra, cases[c].first);
+        srand(1);
+        for (int i = 0; i < count; i++)
+            codepoints[i] = cases[c].textFirst + rand()%cases[c].textCount;
+
+        long linearSum = 0, tableSum = 0;
+        const double linear = time_lookups(glyph_index_linear, font, codepoints, count, &linearSum);
+        const double table = time_lookups(rlGetGlyphIndex, font, codepoints, count, &tableSum);
+        if (linearSum != tableSum) ok = false;
+        printf("%-24s %10.2f %10.2f\n", cases[c].name, linear, table);
+        rlUnloadFontData(font.glyphs, font.glyphCount);
+    }
+
+    free(codepoints);
+    for (int i = 0; i < BENCH_FONTS; i++) rlUnloadFontData(others[i].glyphs, others[i].glyphCount);
+    return ok;
+}
+
+// OpenGL 3.3 core context drawing into a BENCH_WIDTH x BENCH_HEIGHT
+// framebuffer, set up for rlgl the way rlInitWindow() would
+static bool gl_init(void)
+{
+    // surfaceless on Mesa, the default display elsewhere
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if (getPlatformDisplay != NULL) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) return false;
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    EGLContext context = eglCreateContext(display, configCount > 0 ? config : NULL, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) return false;
+
+    rlLoadExtensions((void *)eglGetProcAddress);
+    rlglInit(BENCH_WIDTH, BENCH_HEIGHT);
+
+    const unsigned int target = rlLoadFramebuffer();
+    const unsigned int color = rlLoadTexture(NULL, BENCH_WIDTH, BENCH_HEIGHT, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+    rlFramebufferAttach(target, color, RL_ATTACHMENT_COLOR_CHANNEL0, RL_ATTACHMENT_TEXTURE2D, 0);
+    if (!rlFramebufferComplete(target)) return false;
+    rlEnableFramebuffer(target);
+
+    rlViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    rlMatrixMode(RL_PROJECTION);
+    rlLoadIdentity();
+    rlOrtho(0, BENCH_WIDTH, BENCH_HEIGHT, 0, 0.0, 1.0);
+    rlMatrixMode(RL_MODELVIEW);
+    rlLoadIdentity();
+    rlEnableColorBlend();
+    return true;
+}
+
+// waits until the gpu drew everything
+static void gl_finish(void)
+{
+    static void (*finish)(void) = NULL;
+    if (finish == NULL) finish = (void (*)(void))eglGetProcAddress("glFinish");
+    rlDrawRenderBatchActive();
+    finish();
+}
+
+// printable ascii in 16x16 cells of a 256x256 atlas, with a checkered glyph
+// in every cell so the drawn pixels can be compared
+static rlFont font_make_atlas(void)
+{
+    rlFont font = font_make(0, 0);
+    font.baseSize = 16;
+    font.glyphPadding = 1;
+    font.recs = RL_CALLOC(font.glyphCount, sizeof(rlRectangle));
+    for (int i = 0; i < font.glyphCount; i++)
+    {
+        font.recs[i] = (rlRectangle){ (float)(i%16*16 + 2), (float)(i/16*16 + 2), 9, 12 };
+        font.glyphs[i].advanceX = 10;
+        font.glyphs[i].offsetY = 2;
+    }
+
+    unsigned char *pixels = RL_CALLOC(256*256, 4);
+    for (int y = 0; y < 256; y++)
+        for (int x = 0; x < 256; x++)
+            if (((x + y + y/16) & 3) == 0) memset(pixels + (y*256 + x)*4, 255, 4);
+    font.texture.id = rlLoadTexture(pixels, 256, 256, RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, 1);
+    font.texture.width = 256;
+    font.texture.height = 256;
+    font.texture.mipmaps = 1;
+    font.texture.format = RL_PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    RL_FREE(pixels);
+    return font;
+}
+
+// what rlDrawTextEx() did before it wrote the quads itself: one
+// rlDrawTextCodepoint() (and rlDrawTexturePro()) per glyph
+static void draw_text_per_glyph(rlFont font, const char *text, rlVector2 position, float fontSize, float spacing, rlColor tint)
+{
+    const int size = (int)strlen(text);
+    float textOffsetY = 0;
+    float textOffsetX = 0.0f;
+    const float scaleFactor = fontSize/font.baseSize;
+
+    for (int i = 0; i < size;)
+    {
+        int codepointByteCount = 0;
+        const int codepoint = rlGetCodepointNext(&text[i], &codepointByteCount);
+        const int index = rlGetGlyphIndex(font, codepoint);
+
+        if (codepoint == '\n')
+        {
+            textOffsetY += fontSize + 2;
+            textOffsetX = 0.0f;
+        }
+        else
+        {
+            if ((codepoint != ' ') && (codepoint != '\t'))
+                rlDrawTextCodepoint(font, codepoint, (rlVector2){ position.x + textOffsetX, position.y + textOffsetY }, fontSize, tint);
+
+            if (font.glyphs[index].advanceX == 0) textOffsetX += font.recs[index].width*scaleFactor + spacing;
+            else textOffsetX += font.glyphs[index].advanceX*scaleFactor + spacing;
+        }
+        i += codepointByteCount;
+    }
+}
+
+// `lines` lines of `columns` glyphs, printable ascii with a space every few
+static char *text_make(int lines, int columns)
+{
+    char *text = malloc((size_t)lines*(columns + 1) + 1);
+    char *at = text;
+    srand(2);
+    for (int l = 0; l < lines; l++)
+    {
+        for (int c = 0; c < columns; c++) *at++ = (rand()%6 == 0) ? ' ' : (char)(33 + rand()%94);
+        *at++ = '\n';
+    }
+    *at = '\0';
+    return text;
+}
+
+typedef enum { DRAW_PER_GLYPH, DRAW_TEXT, DRAW_CLIPPED } DrawMode;
+
+static void draw(DrawMode mode, rlFont font, const char *text)
+{
+    const rlVector2 position = { 4, 4 };
+    const rlColor tint = { 0, 228, 48, 255 };
+    switch (mode)
+    {
+        case DRAW_PER_GLYPH: draw_text_per_glyph(font, text, position, 16, 0, tint); break;
+        case DRAW_TEXT: rlDrawTextEx(font, text, position, 16, 0, tint); break;
+        case DRAW_CLIPPED:
+            rlDrawTextClipN(font, text, (int)strlen(text), position, 16, 0,
+                (rlRectangle){ 0, 0, BENCH_WIDTH, BENCH_HEIGHT }, tint);
+            break;
+    }
+}
+
+// glyphs per millisecond of `text` (`glyphs` of them), best of BENCH_ROUNDS of
+// BENCH_FRAMES frames, each one waited for until the gpu is done. `pixels`
+// gets the last frame
+static double time_draw(DrawMode mode, rlFont font, const char *text, long glyphs, unsigned char *pixels)
+{
+    double best = 1e9;
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+    {
+        gl_finish();
+        const double start = now();
+        for (int f = 0; f < BENCH_FRAMES; f++)
+        {
+            rlClearColor(0, 0, 0, 255);
+            rlClearScreenBuffers();
+            draw(mode, font, text);
+            gl_finish();
+        }
+        const double seconds = (now() - start)/BENCH_FRAMES;
+        if (seconds < best) best = seconds;
+    }
+
+    unsigned char *frame = rlReadScreenPixels(BENCH_WIDTH, BENCH_HEIGHT);
+    memcpy(pixels, frame, BENCH_WIDTH*BENCH_HEIGHT*4);
+    RL_FREE(frame);
+    return glyphs/(best*1000.0);
+}
+
+static bool bench_draw(void)
+{
+    if (!gl_init())
+    {
+        printf("no OpenGL 3.3 context, drawing not measured\n");
+        return true;
+    }
+
+    rlFont font = font_make_atlas();
+    unsigned char *before = malloc(BENCH_WIDTH*BENCH_HEIGHT*4);
+    unsigned char *after = malloc(BENCH_WIDTH*BENCH_HEIGHT*4);
+    bool ok = true;
+
+    // a screen full of text, and one of long lines running off it
+    struct {
+        const char *name;
+        int lines;
+        int columns;
+        DrawMode mode;
+    } cases[] = {
+        { "full screen, 40x126", 40, 126, DRAW_TEXT },
+        { "long lines, 40x4000", 40, 4000, DRAW_CLIPPED },
+    };
+
+    printf("\n%-24s %10s %10s\n", "glyphs per ms", "per glyph", "batched");
+    for (size_t c = 0; c < sizeof(cases)/sizeof(cases[0]); c++)
+    {
+        char *text = text_make(cases[c].lines, cases[c].columns);
+        const long glyphs = (long)cases[c].lines*cases[c].columns;
+        const double perGlyph = time_draw(DRAW_PER_GLYPH, font, text, glyphs, before);
+        const double batched = time_draw(cases[c].mode, font, text, glyphs, after);
+        if (memcmp(before, after, BENCH_WIDTH*BENCH_HEIGHT*4) != 0) ok = false;
+        printf("%-24s %10.0f %10.0f\n", cases[c].name, perGlyph, batched);
+        free(text);
+    }
+
+    free(before);
+    free(after);
+    return ok;
+}
+
+int main(void)
+{
+    rlSetTraceLogLevel(LOG_WARNING);
+
+    bool ok = bench_lookup();
+    ok = bench_draw() && ok;
+    if (!ok)
+    {
+        fprintf(stderr, "results differ from the code they replaced\n");
+        return 1;
+    }
+    return 0;
+}
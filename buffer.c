@@ -0,0 +1,364 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "buffer.h"
+#include "dynamic_array.h"
+#include "arena.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BUFFER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ADD_BLOCK_SIZE (64*1024)
+
+void buffer_init(Buffer *b)
+{
+    b->original = NULL;
+    b->originalCount = 0;
+    b->originalMapped = false;
+    b->add = NULL;
+    da_init(&b->pieces);
+    b->count = 0;
+    b->version = 0;
+    b->cachePiece = 0;
+    b->cacheStart = 0;
+}
+
+void buffer_free(Buffer *b)
+{
+    const size_t version = b->version;
+#ifdef BUFFER_MMAP
+    if (b->originalMapped)
+        munmap((void *)b->original, b->originalCount);
+    else
+#endif
+        free((void *)b->original);
+    while (b->add != NULL)
+    {
+        AddBlock *prev = b->add->prev;
+        free(b->add);
+        b->add = prev;
+    }
+    da_free(&b->pieces);
+    buffer_init(b);
+    b->version = version + 1;
+}
+
+void buffer_load(Buffer *b, char *data, size_t count)
+{
+    buffer_free(b);
+    b->original = data;
+    b->originalCount = count;
+    if (count > 0)
+        da_append(&b->pieces, ((Piece){ data, count }));
+    b->count = count;
+}
+
+bool buffer_load_file(Buffer *b, const char *filename)
+{
+#ifdef BUFFER_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size > 0)
+    {
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            close(fd); // the mapping keeps the file alive
+            buffer_free(b);
+            b->original = data;
+            b->originalCount = st.st_size;
+            b->originalMapped = true;
+            da_append(&b->pieces, ((Piece){ data, st.st_size }));
+            b->count = st.st_size;
+            // the whole file is about to be scanned for lines
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            return true;
+        }
+    }
+    close(fd);
+#endif
+
+    // fallback: read the whole file into memory
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) return false;
+
+    fseek(f, 0L, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    if (size < 0)
+    {
+        fclose(f);
+        return false;
+    }
+
+    char *data = malloc(size > 0 ? size : 1);
+    assert(data != NULL);
+    size_t count = fread(data, 1, size, f);
+    fclose(f);
+
+    buffer_load(b, data, count);
+    return true;
+}
+
+void buffer_prefetch(Buffer *b, size_t pos, size_t n)
+{
+#ifdef BUFFER_MMAP
+    if (!b->originalMapped || n == 0) return;
+    const size_t page = sysconf(_SC_PAGESIZE);
+
+    // only the pieces still pointing into the mapping need paging in
+    for (size_t done=0; done<n;)
+    {
+        size_t len;
+        const char *chunk = buffer_chunk(b, pos + done, &len);
+        if (len == 0) break;
+        if (len > n - done) len = n - done;
+
+        if (chunk >= b->original && chunk < b->original + b->originalCount)
+        {
+            size_t from = (chunk - b->original) / page * page;
+            size_t to = chunk - b->original + len;
+            madvise((char *)b->original + from, to - from, MADV_WILLNEED);
+        }
+        done += len;
+    }
+#else
+    (void)b; (void)pos; (void)n;
+#endif
+}
+
+void buffer_release_pages(Buffer *b)
+{
+#ifdef BUFFER_MMAP
+    if (!b->originalMapped) return;
+    // the mapping is never written to, so dropping its pages loses nothing
+    madvise((void *)b->original, b->originalCount, MADV_DONTNEED);
+    madvise((void *)b->original, b->originalCount, MADV_NORMAL);
+#else
+    (void)b;
+#endif
+}
+
+// appends text to the add buffer and returns where it was stored
+static const char *buffer_add(Buffer *b, const char *text, size_t n)
+{
+    AddBlock *block = b->add;
+    if (block == NULL || block->size - block->count < n)
+    {
+        // never realloc: pieces point into the old blocks
+        size_t size = n > ADD_BLOCK_SIZE ? n : ADD_BLOCK_SIZE;
+        block = malloc(sizeof(AddBlock) + size);
+        assert(block != NULL);
+        block->prev = b->add;
+        block->size = size;
+        block->count = 0;
+        b->add = block;
+    }
+    char *dest = block->items + block->count;
+    memcpy(dest, text, n);
+    block->count += n;
+    return dest;
+}
+
+static void buffer_insert_piece(Buffer *b, size_t index, Piece piece)
+{
+    da_append(&b->pieces, piece); // grows the array by one
+    Piece *src = b->pieces.items + index;
+    memmove(src + 1, src, (b->pieces.count - 1 - index) * sizeof(Piece));
+    b->pieces.items[index] = piece;
+}
+
+// returns index of the piece containing `pos` and stores the buffer position
+// the piece starts at in `pieceStart`
+// - for pos == count, returns pieces.count
+static size_t buffer_find_piece(Buffer *b, size_t pos, size_t *pieceStart)
+{
+    assert(pos <= b->count);
+    size_t i = b->cachePiece;
+    size_t start = b->cacheStart;
+
+    while (i > 0 && start > pos)
+    {
+        i--;
+        start -= b->pieces.items[i].len;
+    }
+    while (i < b->pieces.count && pos >= start + b->pieces.items[i].len)
+    {
+        start += b->pieces.items[i].len;
+        i++;
+    }
+
+    b->cachePiece = i;
+    b->cacheStart = start;
+    *pieceStart = start;
+    return i;
+}
+
+bool buffer_unmap(Buffer *b)
+{
+#ifdef BUFFER_MMAP
+    if (!b->originalMapped) return true;
+    char *copy = malloc(b->originalCount);
+    if (copy == NULL) return false;
+    memcpy(copy, b->original, b->originalCount);
+
+    // the pieces of the original move over to the copy
+    const char *end = b->original + b->originalCount;
+    for (size_t i=0; i<b->pieces.count; i++)
+    {
+        Piece *p = &b->pieces.items[i];
+        if (p->data >= b->original && p->data < end)
+            p->data = copy + (p->data - b->original);
+    }
+    munmap((void *)b->original, b->originalCount);
+    b->original = copy;
+    b->originalMapped = false;
+#endif
+    return true;
+}
+
+void buffer_insert(Buffer *b, size_t pos, const char *text, size_t n)
+{
+    if (n == 0) return;
+    const char *data = buffer_add(b, text, n);
+
+    size_t start;
+    size_t i = buffer_find_piece(b, pos, &start);
+    size_t offset = pos - start;
+
+    if (offset == 0)
+    {
+        Piece *prev = i > 0 ? &b->pieces.items[i-1] : NULL;
+        if (prev != NULL && prev->data + prev->len == data)
+        {   // typing: the previous piece ends right where the new text starts
+            b->cachePiece = i-1;
+            b->cacheStart = start - prev->len;
+            prev->len += n;
+        }
+        else
+        {
+            buffer_insert_piece(b, i, (Piece){ data, n });
+        }
+    }
+    else
+    {   // split the piece in two and put the new text in between
+        Piece *p = &b->pieces.items[i];
+        Piece tail = { p->data + offset, p->len - offset };
+        p->len = offset;
+        buffer_insert_piece(b, i+1, (Piece){ data, n });
+        buffer_insert_piece(b, i+2, tail);
+    }
+
+    b->count += n;
+    b->version++;
+}
+
+void buffer_delete(Buffer *b, size_t pos, size_t n)
+{
+    if (n == 0) return;
+    assert(pos + n <= b->count);
+
+    size_t start;
+    size_t i = buffer_find_piece(b, pos, &start);
+    size_t offset = pos - start;
+    Piece *p = &b->pieces.items[i];
+
+    b->count -= n;
+    b->version++;
+
+    if (offset > 0 && offset + n < p->len)
+    {   // deleted range is inside a single piece
+        Piece tail = { p->data + offset + n, p->len - offset - n };
+        p->len = offset;
+        buffer_insert_piece(b, i+1, tail);
+        return;
+    }
+
+    size_t first = i; // first piece to be removed entirely
+    if (offset > 0)
+    {   // keep the head of the first piece
+        n -= p->len - offset;
+        p->len = offset;
+        first++;
+    }
+
+    size_t last = first;
+    while (n > 0)
+    {
+        assert(last < b->pieces.count);
+        Piece *piece = &b->pieces.items[last];
+        if (piece->len > n)
+        {   // keep the tail of the last piece
+            piece->data += n;
+            piece->len -= n;
+            break;
+        }
+        n -= piece->len;
+        last++;
+    }
+
+    Piece *dest = b->pieces.items + first;
+    memmove(dest, b->pieces.items + last, (b->pieces.count - last) * sizeof(Piece));
+    b->pieces.count -= last - first;
+}
+
+char buffer_at(Buffer *b, size_t pos)
+{
+    assert(pos < b->count);
+    size_t start;
+    size_t i = buffer_find_piece(b, pos, &start);
+    return b->pieces.items[i].data[pos - start];
+}
+
+const char *buffer_chunk(Buffer *b, size_t pos, size_t *len)
+{
+    size_t start;
+    size_t i = buffer_find_piece(b, pos, &start);
+    if (i == b->pieces.count)
+    {
+        *len = 0;
+        return NULL;
+    }
+    const Piece p = b->pieces.items[i];
+    *len = p.len - (pos - start);
+    return p.data + (pos - start);
+}
+
+size_t buffer_copy(Buffer *b, size_t pos, size_t n, char *dest)
+{
+    size_t copied = 0;
+    while (copied < n)
+    {
+        size_t len;
+        const char *chunk = buffer_chunk(b, pos + copied, &len);
+        if (len == 0) break;
+        if (len > n - copied) len = n - copied;
+        memcpy(dest + copied, chunk, len);
+        copied += len;
+    }
+    return copied;
+}
+
+bool buffer_write(Buffer *b, FILE *f)
+{
+    for (size_t i=0; i<b->pieces.count; i++)
+    {
+        const Piece p = b->pieces.items[i];
+        if (fwrite(p.data, 1, p.len, f) != p.len)
+            return false;
+    }
+    return true;
+}
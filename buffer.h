@@ -0,0 +1,86 @@
+#pragma once
+/*
+ * Piece table text storage
+ *
+ * The text is never stored contiguously. Instead it is described by a list
+ * of pieces, each one pointing at a span of either
+ *   - the original buffer (the file contents, read-only, never copied), or
+ *   - the add buffer (append-only blocks holding everything ever typed)
+ *
+ * Inserting or deleting only splits/trims pieces, so the cost of an edit
+ * depends on the number of pieces and not on the size of the file.
+ *
+ * Add blocks never move or shrink once allocated, so a `const char*` into
+ * them stays valid until buffer_free().
+ *
+ * Files are memory mapped where possible, so unmodified text is served
+ * straight from the page cache and only the pages actually looked at are
+ * ever read in.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    const char *data; // points into the original or into an add block
+    size_t      len;
+} Piece;
+
+typedef struct {
+    Piece *items;
+    size_t size;
+    size_t count;
+} Pieces;
+
+typedef struct AddBlock AddBlock;
+struct AddBlock {
+    AddBlock *prev;
+    size_t    size;
+    size_t    count;
+    char      items[];
+};
+
+typedef struct {
+    const char *original; // file contents, owned by the buffer
+    size_t originalCount;
+    bool   originalMapped;  // original is a read-only mapping of the file
+
+    AddBlock *add;        // newest add block, older ones linked through prev
+    Pieces    pieces;
+
+    size_t count;         // total number of bytes in the text
+    size_t version;       // bumped by every change to the text
+
+    // last looked up piece, makes sequential access O(1)
+    size_t cachePiece;
+    size_t cacheStart;
+} Buffer;
+
+void   buffer_init(Buffer *b);
+void   buffer_free(Buffer *b);
+
+// takes ownership of `data` (must be allocated with malloc)
+void   buffer_load(Buffer *b, char *data, size_t count);
+// maps (or reads if mapping is not supported) the file as the original buffer
+bool   buffer_load_file(Buffer *b, const char *filename);
+
+// hints that the text in [pos, pos+n) is about to be looked at
+void   buffer_prefetch(Buffer *b, size_t pos, size_t n);
+// drops the mapped pages read so far, they are read in again when touched
+void   buffer_release_pages(Buffer *b);
+// copies a mapped original into memory, so the file can be overwritten.
+// Pointers into the mapping handed out before (snapshots of the pieces
+// included) are not valid anymore. Returns false when out of memory
+bool   buffer_unmap(Buffer *b);
+
+void   buffer_insert(Buffer *b, size_t pos, const char *text, size_t n);
+void   buffer_delete(Buffer *b, size_t pos, size_t n);
+
+char   buffer_at(Buffer *b, size_t pos);
+// copies `n` bytes starting at `pos` into `dest`, returns bytes copied
+size_t buffer_copy(Buffer *b, size_t pos, size_t n, char *dest);
+// returns a pointer to the contiguous run of text starting at `pos`
+// and stores its length in `len` (0 when pos is at the end)
+const char *buffer_chunk(Buffer *b, size_t pos, size_t *len);
+
+bool   buffer_write(Buffer *b, FILE *f);
@@ -0,0 +1,177 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <raylib.h>
+#include <rlgl.h>
+#include <raymath.h>
+#include "gpu_text.h"
+#include "dynamic_array.h"
+#include "arena.h"
+
+static const char *vertexShader =
+    "#version 330\n"
+    "in vec2 vertexCorner;\n"   // corner of the unit quad
+    "in vec4 instanceRect;\n"
+    "in vec4 instanceUv;\n"
+    "in vec4 instanceColor;\n"
+    "uniform mat4 mvp;\n"
+    "uniform vec2 offset;\n"
+    "out vec2 fragTexCoord;\n"
+    "out vec4 fragColor;\n"
+    "void main()\n"
+    "{\n"
+    "    vec2 pos = offset + instanceRect.xy + vertexCorner*instanceRect.zw;\n"
+    "    fragTexCoord = mix(instanceUv.xy, instanceUv.zw, vertexCorner);\n"
+    "    fragColor = instanceColor;\n"
+    "    gl_Position = mvp*vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *fragmentShader =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "out vec4 finalColor;\n"
+    "void main()\n"
+    "{\n"
+    "    finalColor = texture(texture0, fragTexCoord)*fragColor;\n"
+    "}\n";
+
+// two triangles covering the unit square
+static const float quadCorners[] = {
+    0, 0,  0, 1,  1, 1,
+    0, 0,  1, 1,  1, 0,
+};
+
+// points the instance attributes at the instance vbo, needed again
+// whenever the vbo gets replaced by a bigger one
+static void gpu_text_bind_instances(GpuText *t)
+{
+    const int stride = sizeof(GlyphInstance);
+    rlEnableVertexArray(t->vao);
+    rlEnableVertexBuffer(t->instanceVbo);
+
+    rlSetVertexAttribute(t->locRect, 4, RL_FLOAT, false, stride, (void *)offsetof(GlyphInstance, x));
+    rlSetVertexAttribute(t->locUv, 4, RL_FLOAT, false, stride, (void *)offsetof(GlyphInstance, u0));
+    rlSetVertexAttribute(t->locColor, 4, RL_UNSIGNED_BYTE, true, stride, (void *)offsetof(GlyphInstance, color));
+    rlEnableVertexAttribute(t->locRect);
+    rlEnableVertexAttribute(t->locUv);
+    rlEnableVertexAttribute(t->locColor);
+    rlSetVertexAttributeDivisor(t->locRect, 1);
+    rlSetVertexAttributeDivisor(t->locUv, 1);
+    rlSetVertexAttributeDivisor(t->locColor, 1);
+
+    rlDisableVertexBuffer();
+    rlDisableVertexArray();
+}
+
+bool gpu_text_init(GpuText *t)
+{
+    *t = (GpuText) {0};
+    da_init(&t->staging);
+
+    // rlGetVersion() is what raylib was built for, the shaders failing to
+    // compile is what catches contexts without GLSL 3.30 (and instancing)
+    const int version = rlGetVersion();
+    if (version != RL_OPENGL_33 && version != RL_OPENGL_43) return false;
+
+    // a shader that fails to compile comes back as the default one, which
+    // must not be unloaded below
+    t->shader = rlLoadShaderCode(vertexShader, fragmentShader);
+    if (t->shader == 0 || t->shader == rlGetShaderIdDefault()) return false;
+
+    t->locMvp = rlGetLocationUniform(t->shader, "mvp");
+    t->locOffset = rlGetLocationUniform(t->shader, "offset");
+    t->locTexture = rlGetLocationUniform(t->shader, "texture0");
+    t->locCorner = rlGetLocationAttrib(t->shader, "vertexCorner");
+    t->locRect = rlGetLocationAttrib(t->shader, "instanceRect");
+    t->locUv = rlGetLocationAttrib(t->shader, "instanceUv");
+    t->locColor = rlGetLocationAttrib(t->shader, "instanceColor");
+    if (t->locCorner < 0 || t->locRect < 0 || t->locUv < 0 || t->locColor < 0)
+    {
+        rlUnloadShaderProgram(t->shader);
+        return false;
+    }
+
+    t->vao = rlLoadVertexArray();
+    if (t->vao == 0)
+    {
+        rlUnloadShaderProgram(t->shader);
+        return false;
+    }
+    rlEnableVertexArray(t->vao);
+    t->quadVbo = rlLoadVertexBuffer(quadCorners, sizeof(quadCorners), false);
+    rlSetVertexAttribute(t->locCorner, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(t->locCorner);
+    rlDisableVertexBuffer();
+    rlDisableVertexArray();
+
+    t->ok = true;
+    return true;
+}
+
+void gpu_text_free(GpuText *t)
+{
+    if (t->ok)
+    {
+        rlUnloadVertexArray(t->vao);
+        rlUnloadVertexBuffer(t->quadVbo);
+        if (t->instanceVbo != 0) rlUnloadVertexBuffer(t->instanceVbo);
+        rlUnloadShaderProgram(t->shader);
+    }
+    da_free(&t->staging);
+    t->ok = false;
+}
+
+void gpu_text_clear(GpuText *t)
+{
+    t->staging.count = 0;
+}
+
+void gpu_text_push(GpuText *t, GlyphInstance glyph)
+{
+    da_append(&t->staging, glyph);
+}
+
+void gpu_text_upload(GpuText *t)
+{
+    if (!t->ok) return;
+    const size_t count = t->staging.count;
+    const int bytes = count * sizeof(GlyphInstance);
+
+    if (count > t->instanceSize)
+    {   // room for twice as much, so growing text does not reallocate every time
+        if (t->instanceVbo != 0) rlUnloadVertexBuffer(t->instanceVbo);
+        t->instanceSize = count * 2;
+        t->instanceVbo = rlLoadVertexBuffer(NULL, t->instanceSize * sizeof(GlyphInstance), true);
+        gpu_text_bind_instances(t);
+    }
+    if (count > 0)
+        rlUpdateVertexBuffer(t->instanceVbo, t->staging.items, bytes, 0);
+    t->instanceCount = count;
+}
+
+void gpu_text_draw(GpuText *t, Texture2D texture, Vector2 offset)
+{
+    if (!t->ok || t->instanceCount == 0) return;
+
+    // whatever got batched so far has to end up below the text
+    rlDrawRenderBatchActive();
+
+    rlEnableShader(t->shader);
+    const Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    rlSetUniformMatrix(t->locMvp, mvp);
+    const float off[2] = { offset.x, offset.y };
+    rlSetUniform(t->locOffset, off, RL_SHADER_UNIFORM_VEC2, 1);
+
+    const int slot = 0;
+    rlActiveTextureSlot(slot);
+    rlEnableTexture(texture.id);
+    rlSetUniform(t->locTexture, &slot, RL_SHADER_UNIFORM_INT, 1);
+
+    rlEnableVertexArray(t->vao);
+    rlDrawVertexArrayInstanced(0, 6, t->instanceCount);
+    rlDisableVertexArray();
+
+    rlDisableTexture();
+    rlDisableShader();
+}
@@ -0,0 +1,61 @@
+#pragma once
+/*
+ * Instanced glyph renderer (OpenGL 3.3+)
+ *
+ * Every glyph is one instance (quad position and size, atlas rect, color)
+ * kept in a vertex buffer that stays on the GPU between frames. The whole
+ * text is drawn with a single instanced call, and moving it around only
+ * changes the `offset` uniform, so scrolling and cursor movement upload
+ * nothing.
+ *
+ * gpu_text_init() returns false when the context is older than GL 3.3 or the
+ * shader does not compile, the caller is expected to fall back to the
+ * regular raylib drawing then.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <raylib.h>
+
+typedef struct {
+    float x, y;           // quad position relative to the text origin
+    float width, height;
+    float u0, v0, u1, v1; // atlas rect in texture coordinates
+    unsigned char color[4];
+} GlyphInstance;
+
+typedef struct {
+    GlyphInstance *items; // instances waiting for gpu_text_upload()
+    size_t size;
+    size_t count;
+} GlyphInstances;
+
+typedef struct {
+    bool ok;
+    unsigned int shader;
+    unsigned int vao;
+    unsigned int quadVbo;
+    unsigned int instanceVbo;
+    size_t       instanceSize;  // instances the vbo has room for
+    size_t       instanceCount; // instances uploaded
+
+    int locMvp;
+    int locOffset;
+    int locTexture;
+    int locCorner;
+    int locRect;
+    int locUv;
+    int locColor;
+
+    GlyphInstances staging;
+} GpuText;
+
+bool gpu_text_init(GpuText *t);
+void gpu_text_free(GpuText *t);
+
+// staging: clear, push the glyphs, then upload them in one go
+void gpu_text_clear(GpuText *t);
+void gpu_text_push(GpuText *t, GlyphInstance glyph);
+void gpu_text_upload(GpuText *t);
+
+// draws the uploaded glyphs with `texture`, moved by `offset`
+void gpu_text_draw(GpuText *t, Texture2D texture, Vector2 offset);
@@ -0,0 +1,630 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "line_index.h"
+#include "dynamic_array.h"
+#include "scan.h"
+#include "arena.h"
+
+static LineLeaf *leaf_new(void)
+{
+    LineLeaf *leaf = malloc(sizeof(LineLeaf));
+    assert(leaf != NULL);
+    leaf->count = 0;
+    leaf->bytes = 0;
+    leaf->visual = 0;
+    return leaf;
+}
+
+static size_t leaf_sum(const LineLeaf *leaf, size_t from, size_t to)
+{
+    size_t sum = 0;
+    for (size_t i=from; i<to; i++) sum += leaf->lens[i];
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// Fenwick trees over the leaves
+// NOTE: deltas are passed as size_t, negative ones simply wrap around
+
+static void lines_tree_build(Lines *l)
+{
+    const size_t n = l->leaves.count;
+    if (l->treeSize < n + 1)
+    {
+        l->treeSize = (n + 1) * 2;
+        l->treeLines = realloc(l->treeLines, l->treeSize * sizeof(size_t));
+        l->treeBytes = realloc(l->treeBytes, l->treeSize * sizeof(size_t));
+        l->treeVisual = realloc(l->treeVisual, l->treeSize * sizeof(size_t));
+        assert(l->treeLines != NULL && l->treeBytes != NULL && l->treeVisual != NULL);
+    }
+
+    l->treeLines[0] = 0;
+    l->treeBytes[0] = 0;
+    l->treeVisual[0] = 0;
+    for (size_t i=1; i<=n; i++)
+    {
+        l->treeLines[i] = l->leaves.items[i-1]->count;
+        l->treeBytes[i] = l->leaves.items[i-1]->bytes;
+        l->treeVisual[i] = l->leaves.items[i-1]->visual;
+    }
+    // push every node's sum up into its parent, O(n)
+    for (size_t i=1; i<=n; i++)
+    {
+        size_t parent = i + (i & -i);
+        if (parent <= n)
+        {
+            l->treeLines[parent] += l->treeLines[i];
+            l->treeBytes[parent] += l->treeBytes[i];
+            l->treeVisual[parent] += l->treeVisual[i];
+        }
+    }
+    l->treeDirty = false;
+}
+
+static void lines_tree_ensure(Lines *l)
+{
+    if (l->treeDirty) lines_tree_build(l);
+}
+
+static void lines_tree_add(Lines *l, size_t leaf, size_t dLines, size_t dBytes, size_t dVisual)
+{
+    if (l->treeDirty) return; // gets rebuilt anyway
+    for (size_t i=leaf+1; i<=l->leaves.count; i += i & -i)
+    {
+        l->treeLines[i] += dLines;
+        l->treeBytes[i] += dBytes;
+        l->treeVisual[i] += dVisual;
+    }
+}
+
+// sum of the first `leaf` leaves
+static size_t lines_tree_prefix(const size_t *tree, size_t leaf)
+{
+    size_t sum = 0;
+    for (size_t i=leaf; i>0; i -= i & -i) sum += tree[i];
+    return sum;
+}
+
+// returns the leaf the `target`th unit (0-based) falls in and
+// subtracts everything before that leaf from `target`
+// - returns leaves.count if target is past the end
+static size_t lines_tree_search(const Lines *l, const size_t *tree, size_t *target)
+{
+    const size_t n = l->leaves.count;
+    size_t step = 1;
+    while (step*2 <= n) step *= 2;
+
+    size_t idx = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (idx + step <= n && tree[idx + step] <= *target)
+        {
+            idx += step;
+            *target -= tree[idx];
+        }
+    }
+    return idx;
+}
+
+// ---------------------------------------------------------------------------
+// Locating lines
+
+static void lines_locate_row(Lines *l, size_t row, size_t *leaf, size_t *idx)
+{
+    assert(row < l->count);
+    lines_tree_ensure(l);
+    size_t target = row;
+    *leaf = lines_tree_search(l, l->treeLines, &target);
+    *idx = target;
+}
+
+// finds the line containing `pos`, a line contains its '\n'
+static void lines_locate_pos(Lines *l, size_t pos, size_t *leaf, size_t *idx, size_t *row, size_t *start)
+{
+    assert(pos <= l->bytes);
+    lines_tree_ensure(l);
+    size_t target = pos;
+    size_t a = lines_tree_search(l, l->treeBytes, &target);
+
+    size_t j = 0;
+    if (a == l->leaves.count)
+    {   // end of the buffer belongs to the last line
+        a = l->leaves.count - 1;
+        j = l->leaves.items[a]->count - 1;
+        target = l->leaves.items[a]->lens[j];
+    }
+    else
+    {
+        const LineLeaf *lf = l->leaves.items[a];
+        while (target >= lf->lens[j])
+        {
+            target -= lf->lens[j];
+            j++;
+        }
+    }
+
+    *leaf = a;
+    *idx = j;
+    *row = lines_tree_prefix(l->treeLines, a) + j;
+    *start = pos - target;
+}
+
+Line lines_get(Lines *l, size_t row)
+{
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    const LineLeaf *leaf = l->leaves.items[a];
+
+    Line line;
+    line.start = lines_tree_prefix(l->treeBytes, a) + leaf_sum(leaf, 0, j);
+    line.end = line.start + leaf->lens[j];
+    if (row + 1 < l->count) line.end--; // exclude the '\n'
+    return line;
+}
+
+size_t lines_find_row(Lines *l, size_t pos)
+{
+    size_t a, j, row, start;
+    lines_locate_pos(l, pos, &a, &j, &row, &start);
+    return row;
+}
+
+// ---------------------------------------------------------------------------
+// Modifying lines
+
+void lines_init(Lines *l)
+{
+    da_init(&l->leaves);
+    l->treeLines = NULL;
+    l->treeBytes = NULL;
+    l->treeVisual = NULL;
+    l->treeSize = 0;
+    l->treeDirty = true;
+    l->count = 0;
+    l->bytes = 0;
+    l->visual = 0;
+    // there's always atleast one line
+    lines_push(l, 0);
+}
+
+void lines_clear(Lines *l)
+{
+    for (size_t i=0; i<l->leaves.count; i++)
+        free(l->leaves.items[i]);
+    l->leaves.count = 0;
+    l->treeDirty = true;
+    l->count = 0;
+    l->bytes = 0;
+    l->visual = 0;
+}
+
+void lines_free(Lines *l)
+{
+    lines_clear(l);
+    da_free(&l->leaves);
+    free(l->treeLines);
+    free(l->treeBytes);
+    free(l->treeVisual);
+    l->treeLines = NULL;
+    l->treeBytes = NULL;
+    l->treeVisual = NULL;
+    l->treeSize = 0;
+}
+
+void lines_push(Lines *l, size_t len)
+{
+    if (l->leaves.count == 0 || l->leaves.items[l->leaves.count - 1]->count == LINE_LEAF_CAP)
+    {
+        da_append(&l->leaves, leaf_new());
+        l->treeDirty = true;
+    }
+    LineLeaf *leaf = l->leaves.items[l->leaves.count - 1];
+    leaf->rows[leaf->count] = 1;
+    leaf->states[leaf->count] = 0;
+    leaf->lens[leaf->count++] = len;
+    leaf->bytes += len;
+    leaf->visual++;
+    l->count++;
+    l->bytes += len;
+    l->visual++;
+    lines_tree_add(l, l->leaves.count - 1, 1, len, 1);
+}
+
+// ---------------------------------------------------------------------------
+// Building the index
+
+#define LINES_PARALLEL_MIN  (8*1024*1024)  // smaller inputs are scanned on the calling thread
+#define LINES_SEGMENT_MIN   (1024*1024)
+#define LINES_SEGMENT_MAX   (16*1024*1024) // keeps offsets in a segment within 32 bits
+
+typedef struct {
+    const char *data;
+    size_t      len;
+    size_t      pos;   // buffer position of data[0]
+
+    struct {
+        uint32_t *items;   // offsets of every '\n' in data
+        size_t size;
+        size_t count;
+    } newlines;
+} LineSegment;
+
+typedef struct {
+    LineSegment  *items;
+    size_t        size;
+    size_t        count;
+    atomic_size_t next; // next segment to be picked up by a worker
+} LineSegments;
+
+static void *lines_build_worker(void *arg)
+{
+    LineSegments *segments = arg;
+    for (;;)
+    {
+        const size_t i = atomic_fetch_add(&segments->next, 1);
+        if (i >= segments->count) break;
+
+        LineSegment *s = &segments->items[i];
+        for (size_t j=scan_newline(s->data, s->len); j<s->len; j+=1+scan_newline(s->data+j+1, s->len-j-1))
+            da_append(&s->newlines, (uint32_t)j);
+    }
+    return NULL;
+}
+
+void lines_build(Lines *l, const Piece *pieces, size_t count)
+{
+    size_t total = 0;
+    for (size_t i=0; i<count; i++) total += pieces[i].len;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    size_t threads = total < LINES_PARALLEL_MIN ? 0 : (size_t)cpus - 1;
+
+    // a few segments per thread so that the workers even out
+    size_t segmentLen = total / ((threads + 1) * 4);
+    if (segmentLen < LINES_SEGMENT_MIN) segmentLen = LINES_SEGMENT_MIN;
+    if (segmentLen > LINES_SEGMENT_MAX) segmentLen = LINES_SEGMENT_MAX;
+
+    LineSegments segments = {0};
+    size_t pos = 0;
+    for (size_t i=0; i<count; i++)
+    {
+        for (size_t off=0; off<pieces[i].len; off+=segmentLen)
+        {
+            LineSegment s = {0};
+            s.data = pieces[i].data + off;
+            s.len = pieces[i].len - off < segmentLen ? pieces[i].len - off : segmentLen;
+            s.pos = pos;
+            da_append(&segments, s);
+            pos += s.len;
+        }
+    }
+    atomic_init(&segments.next, 0);
+
+    pthread_t *workers = threads > 0 ? malloc(threads * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    for (; started<threads; started++)
+        if (pthread_create(&workers[started], NULL, lines_build_worker, &segments) != 0)
+            break; // the calling thread picks up the rest
+    lines_build_worker(&segments);
+    for (size_t i=0; i<started; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+
+    // stitch the segments together in order
+    lines_clear(l);
+    size_t lineStart = 0;
+    for (size_t i=0; i<segments.count; i++)
+    {
+        LineSegment *s = &segments.items[i];
+        for (size_t j=0; j<s->newlines.count; j++)
+        {
+            const size_t end = s->pos + s->newlines.items[j] + 1;
+            lines_push(l, end - lineStart);
+            lineStart = end;
+        }
+        da_free(&s->newlines);
+    }
+    // there's always atleast one line
+    lines_push(l, total - lineStart);
+    da_free(&segments);
+}
+
+static void lines_set_len(Lines *l, size_t a, size_t j, size_t len)
+{
+    LineLeaf *leaf = l->leaves.items[a];
+    const size_t delta = len - leaf->lens[j];
+    leaf->lens[j] = len;
+    leaf->bytes += delta;
+    l->bytes += delta;
+    lines_tree_add(l, a, 0, delta, 0);
+}
+
+// inserts `k` lines in leaf `a` before line `j`, splitting the leaf if needed
+static void lines_insert_rows(Lines *l, size_t a, size_t j, const size_t *lens, size_t k)
+{
+    LineLeaf *leaf = l->leaves.items[a];
+    size_t added = 0;
+    for (size_t i=0; i<k; i++) added += lens[i];
+    l->count += k;
+    l->bytes += added;
+    l->visual += k; // new lines start out with one visual row
+
+    if (leaf->count + k <= LINE_LEAF_CAP)
+    {
+        memmove(leaf->lens + j + k, leaf->lens + j, (leaf->count - j) * sizeof(size_t));
+        memmove(leaf->rows + j + k, leaf->rows + j, (leaf->count - j) * sizeof(uint32_t));
+        memmove(leaf->states + j + k, leaf->states + j, (leaf->count - j) * sizeof(uint32_t));
+        memcpy(leaf->lens + j, lens, k * sizeof(size_t));
+        for (size_t i=0; i<k; i++) leaf->rows[j + i] = 1;
+        memset(leaf->states + j, 0, k * sizeof(uint32_t));
+        leaf->count += k;
+        leaf->bytes += added;
+        leaf->visual += k;
+        lines_tree_add(l, a, k, added, k);
+        return;
+    }
+
+    // spread the leaf and the new lines over half full leaves
+    const size_t total = leaf->count + k;
+    size_t *all = malloc(total * sizeof(size_t));
+    uint32_t *allRows = malloc(total * sizeof(uint32_t));
+    uint32_t *allStates = malloc(total * sizeof(uint32_t));
+    assert(all != NULL && allRows != NULL && allStates != NULL);
+    memcpy(all, leaf->lens, j * sizeof(size_t));
+    memcpy(all + j, lens, k * sizeof(size_t));
+    memcpy(all + j + k, leaf->lens + j, (leaf->count - j) * sizeof(size_t));
+    memcpy(allRows, leaf->rows, j * sizeof(uint32_t));
+    for (size_t i=0; i<k; i++) allRows[j + i] = 1;
+    memcpy(allRows + j + k, leaf->rows + j, (leaf->count - j) * sizeof(uint32_t));
+    memcpy(allStates, leaf->states, j * sizeof(uint32_t));
+    memset(allStates + j, 0, k * sizeof(uint32_t));
+    memcpy(allStates + j + k, leaf->states + j, (leaf->count - j) * sizeof(uint32_t));
+
+    const size_t half = LINE_LEAF_CAP/2;
+    const size_t extra = (total + half - 1)/half - 1; // leaves needed besides `leaf`
+
+    for (size_t i=0; i<extra; i++)
+        da_append(&l->leaves, NULL);
+    LineLeaf **after = l->leaves.items + a + 1;
+    memmove(after + extra, after, (l->leaves.count - extra - a - 1) * sizeof(LineLeaf*));
+
+    for (size_t i=0; i<=extra; i++)
+    {
+        LineLeaf *dest = i == 0 ? leaf : leaf_new();
+        const size_t from = i*half;
+        const size_t n = total - from < half ? total - from : half;
+        memcpy(dest->lens, all + from, n * sizeof(size_t));
+        memcpy(dest->rows, allRows + from, n * sizeof(uint32_t));
+        memcpy(dest->states, allStates + from, n * sizeof(uint32_t));
+        dest->count = n;
+        dest->bytes = leaf_sum(dest, 0, n);
+        dest->visual = 0;
+        for (size_t r=0; r<n; r++) dest->visual += dest->rows[r];
+        l->leaves.items[a + i] = dest;
+    }
+
+    free(all);
+    free(allRows);
+    free(allStates);
+    l->treeDirty = true;
+}
+
+// removes `k` lines starting at `row`, dropping leaves that become empty
+static void lines_remove_rows(Lines *l, size_t row, size_t k)
+{
+    if (k == 0) return;
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+
+    // whole leaves being removed are always contiguous
+    size_t wholeFrom = 0;
+    size_t wholeTo = 0;
+
+    while (k > 0)
+    {
+        assert(a < l->leaves.count);
+        LineLeaf *leaf = l->leaves.items[a];
+        const size_t take = k < leaf->count - j ? k : leaf->count - j;
+
+        if (j == 0 && take == leaf->count)
+        {
+            if (wholeFrom == wholeTo) wholeFrom = a;
+            wholeTo = a + 1;
+            l->count -= take;
+            l->bytes -= leaf->bytes;
+            l->visual -= leaf->visual;
+        }
+        else
+        {
+            const size_t removed = leaf_sum(leaf, j, j + take);
+            size_t removedRows = 0;
+            for (size_t i=j; i<j + take; i++) removedRows += leaf->rows[i];
+            memmove(leaf->lens + j, leaf->lens + j + take, (leaf->count - j - take) * sizeof(size_t));
+            memmove(leaf->rows + j, leaf->rows + j + take, (leaf->count - j - take) * sizeof(uint32_t));
+            memmove(leaf->states + j, leaf->states + j + take, (leaf->count - j - take) * sizeof(uint32_t));
+            leaf->count -= take;
+            leaf->bytes -= removed;
+            leaf->visual -= removedRows;
+            l->count -= take;
+            l->bytes -= removed;
+            l->visual -= removedRows;
+            lines_tree_add(l, a, -take, -removed, -removedRows);
+        }
+
+        k -= take;
+        a++;
+        j = 0;
+    }
+
+    if (wholeFrom != wholeTo)
+    {
+        for (size_t i=wholeFrom; i<wholeTo; i++)
+            free(l->leaves.items[i]);
+        LineLeaf **dest = l->leaves.items + wholeFrom;
+        memmove(dest, l->leaves.items + wholeTo, (l->leaves.count - wholeTo) * sizeof(LineLeaf*));
+        l->leaves.count -= wholeTo - wholeFrom;
+        l->treeDirty = true;
+    }
+}
+
+void lines_insert(Lines *l, size_t pos, const char *text, size_t n)
+{
+    size_t a, j, row, start;
+    lines_locate_pos(l, pos, &a, &j, &row, &start);
+    const size_t offset = pos - start;
+    const size_t len = l->leaves.items[a]->lens[j];
+
+    const size_t newlines = scan_count_newlines(text, n);
+    if (newlines == 0)
+    {
+        lines_set_len(l, a, j, len + n);
+        return;
+    }
+
+    // lengths of the lines after the edited one, the edited line ends at the
+    // first inserted '\n' and the last new line gets the rest of it
+    size_t stackLens[64];
+    size_t *lens = newlines <= 64 ? stackLens : malloc(newlines * sizeof(size_t));
+    assert(lens != NULL);
+
+    size_t k = 0;
+    size_t lineStart = 0;
+    for (size_t i=scan_newline(text, n); i<n; i+=1+scan_newline(text+i+1, n-i-1))
+    {
+        if (k == 0) lines_set_len(l, a, j, offset + i + 1);
+        else lens[k-1] = i + 1 - lineStart;
+        k++;
+        lineStart = i + 1;
+    }
+    lens[k-1] = (n - lineStart) + (len - offset);
+
+    // the last new line ends where the edited line did, so it takes its state
+    const uint32_t state = l->leaves.items[a]->states[j];
+    lines_insert_rows(l, a, j + 1, lens, newlines);
+    lines_set_state(l, row + newlines, state);
+    if (lens != stackLens) free(lens);
+}
+
+void lines_delete(Lines *l, size_t pos, size_t n)
+{
+    if (n == 0) return;
+    size_t a, j, first, firstStart;
+    lines_locate_pos(l, pos, &a, &j, &first, &firstStart);
+
+    size_t b, jb, last, lastStart;
+    lines_locate_pos(l, pos + n, &b, &jb, &last, &lastStart);
+    const size_t lastEnd = lastStart + l->leaves.items[b]->lens[jb];
+
+    // the lines touched by the removed range become one, ending in the state
+    // of the last one
+    lines_set_len(l, a, j, lastEnd - firstStart - n);
+    l->leaves.items[a]->states[j] = l->leaves.items[b]->states[jb];
+    lines_remove_rows(l, first + 1, last - first);
+}
+
+// ---------------------------------------------------------------------------
+// Visual rows
+
+size_t lines_get_rows(Lines *l, size_t row)
+{
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    return l->leaves.items[a]->rows[j];
+}
+
+void lines_set_rows(Lines *l, size_t row, size_t rows)
+{
+    assert(rows > 0 && rows <= UINT32_MAX);
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    LineLeaf *leaf = l->leaves.items[a];
+    const size_t delta = rows - leaf->rows[j];
+    leaf->rows[j] = rows;
+    leaf->visual += delta;
+    l->visual += delta;
+    lines_tree_add(l, a, 0, 0, delta);
+}
+
+size_t lines_visual_row(Lines *l, size_t row)
+{
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    const LineLeaf *leaf = l->leaves.items[a];
+    size_t vrow = lines_tree_prefix(l->treeVisual, a);
+    for (size_t i=0; i<j; i++) vrow += leaf->rows[i];
+    return vrow;
+}
+
+size_t lines_find_visual(Lines *l, size_t vrow, size_t *sub)
+{
+    assert(vrow < l->visual);
+    lines_tree_ensure(l);
+    size_t target = vrow;
+    const size_t a = lines_tree_search(l, l->treeVisual, &target);
+    const LineLeaf *leaf = l->leaves.items[a];
+
+    size_t j = 0;
+    while (target >= leaf->rows[j])
+    {
+        target -= leaf->rows[j];
+        j++;
+    }
+    *sub = target;
+    return lines_tree_prefix(l->treeLines, a) + j;
+}
+
+size_t lines_next_long(Lines *l, size_t row, size_t len)
+{
+    if (row >= l->count) return l->count;
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+
+    // a plain scan over the leaves, this only runs when the wrap width changes
+    for (; a<l->leaves.count; a++, j=0)
+    {
+        const LineLeaf *leaf = l->leaves.items[a];
+        for (; j<leaf->count; j++, row++)
+            if (leaf->lens[j] > len || leaf->rows[j] > 1)
+                return row;
+    }
+    return l->count;
+}
+
+// ---------------------------------------------------------------------------
+// Lexer states
+
+uint32_t lines_get_state(Lines *l, size_t row)
+{
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    return l->leaves.items[a]->states[j];
+}
+
+void lines_set_state(Lines *l, size_t row, uint32_t state)
+{
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    l->leaves.items[a]->states[j] = state;
+}
+
+void lines_set_states(Lines *l, size_t row, const uint32_t *states, size_t n)
+{
+    if (n == 0) return;
+    size_t a, j;
+    lines_locate_row(l, row, &a, &j);
+    for (; n > 0; a++, j=0)
+    {
+        assert(a < l->leaves.count);
+        LineLeaf *leaf = l->leaves.items[a];
+        const size_t take = n < leaf->count - j ? n : leaf->count - j;
+        memcpy(leaf->states + j, states, take * sizeof(uint32_t));
+        states += take;
+        n -= take;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+/*
+ * Line index
+ *
+ * Stores the length of every line (including its '\n') in fixed size leaves.
+ * Two Fenwick trees over the leaves hold the number of lines and bytes per
+ * leaf, so both
+ *   - buffer position -> row  (lines_find_row)
+ *   - row -> buffer position  (lines_get)
+ * are O(log n), and an edit only touches the leaves it lands in.
+ *
+ * Line positions are never stored, so nothing has to be shifted after an edit.
+ *
+ * For soft wrapping every line also has a number of visual rows (1 unless
+ * the editor says otherwise with lines_set_rows()), with a third Fenwick tree
+ * so visual row <-> line is O(log n) as well.
+ *
+ * The syntax highlighter keeps the lexer state at the end of every line here
+ * too, so the states move along with the lines on every edit.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer.h"
+
+#define LINE_LEAF_CAP 128
+
+typedef struct {
+    size_t start;
+    size_t end;   // position of the '\n' (or end of buffer for the last line)
+} Line;
+
+typedef struct {
+    size_t count;                // lines in this leaf
+    size_t bytes;                // sum of lens
+    size_t visual;               // sum of rows
+    size_t lens[LINE_LEAF_CAP];  // line lengths including the '\n'
+    uint32_t rows[LINE_LEAF_CAP]; // visual rows of every line
+    uint32_t states[LINE_LEAF_CAP]; // lexer state at the end of every line
+} LineLeaf;
+
+typedef struct {
+    LineLeaf **items;
+    size_t size;
+    size_t count;
+} LineLeaves;
+
+typedef struct {
+    LineLeaves leaves;
+
+    // Fenwick trees over the leaves, 1-based, rebuilt lazily after leaves
+    // get added or removed
+    size_t *treeLines;
+    size_t *treeBytes;
+    size_t *treeVisual;
+    size_t  treeSize;
+    bool    treeDirty;
+
+    size_t count;  // number of lines
+    size_t bytes;  // number of bytes covered
+    size_t visual; // number of visual rows
+} Lines;
+
+void   lines_init(Lines *l);
+void   lines_free(Lines *l);
+
+// rebuilds the index from scratch by scanning the given pieces of text
+// - big inputs are split into segments and scanned by a pool of threads
+void   lines_build(Lines *l, const Piece *pieces, size_t count);
+
+// removes every line, push the lines again with lines_push()
+// - the last pushed line is the one without a '\n'
+void   lines_clear(Lines *l);
+void   lines_push(Lines *l, size_t len);
+
+Line   lines_get(Lines *l, size_t row);
+size_t lines_find_row(Lines *l, size_t pos);
+
+// patch the index after `n` bytes of `text` got inserted at `pos`
+void   lines_insert(Lines *l, size_t pos, const char *text, size_t n);
+// patch the index after `n` bytes got removed at `pos`
+// - lines created by an edit have 1 visual row, a line merged by a delete
+//   keeps the rows of the first one
+void   lines_delete(Lines *l, size_t pos, size_t n);
+
+size_t lines_get_rows(Lines *l, size_t row);
+void   lines_set_rows(Lines *l, size_t row, size_t rows);
+// first visual row of `row`
+size_t lines_visual_row(Lines *l, size_t row);
+// returns the line the visual row `vrow` belongs to and stores which of its
+// visual rows it is in `sub`
+size_t lines_find_visual(Lines *l, size_t vrow, size_t *sub);
+// returns the first line from `row` on that is longer than `len` bytes
+// (counting its '\n') or has more than one visual row, or l->count if none is
+size_t lines_next_long(Lines *l, size_t row, size_t len);
+
+// lexer state at the end of `row`, lines created by an edit start at 0
+// except the one ending where the edited line ended, which keeps its state
+uint32_t lines_get_state(Lines *l, size_t row);
+void     lines_set_state(Lines *l, size_t row, uint32_t state);
+// sets the states of the `n` lines from `row` on
+void     lines_set_states(Lines *l, size_t row, const uint32_t *states, size_t n);
@@ -1,14 +1,25 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <raylib.h>
+#include <rlgl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #ifdef BUILD_RELEASE
 #include "build/font.h"
 #endif
 #include "dynamic_array.h"
+#include "buffer.h"
+#include "line_index.h"
+#include "gpu_text.h"
+#include "syntax.h"
+#include "search.h"
+#include "arena.h"
 
 #define LOG(...) TraceLog(LOG_DEBUG, TextFormat(__VA_ARGS__))
 
@@ -18,26 +29,28 @@
 #define BG_COLOR         BLACK
 #define CURSOR_COLOR     PINK
 #define SELECTION_COLOR  YELLOW
+#define SELECTION_ALPHA  0.35f
+#define KEYWORD_COLOR    SKYBLUE
+#define TYPE_COLOR       PURPLE
+#define STRING_COLOR     ORANGE
+#define NUMBER_COLOR     GOLD
+#define COMMENT_COLOR    GRAY
+#define PREPROC_COLOR    MAGENTA
+#define MATCH_COLOR      SKYBLUE
+#define MATCH_ALPHA      0.3f
+#define CURRENT_MATCH_ALPHA 0.6f
 #define DEFAULT_FONTSIZE 30
+#define TARGET_FPS       60
 
-// TYPES
-typedef struct {
-    size_t start;
-    size_t end;
-} Line;
-
-typedef struct {
-    Line *items;
-    size_t size;
-    size_t count;
-} Lines;
-
-typedef struct {
-    char *items;
-    size_t size;
-    size_t count;
-} Buffer;
+#define GLYPH_CACHE_SIZE 256 // advances of codepoints below this are cached
+#define FRAME_ARENA_SIZE (64*1024)
+#define TILE_ROWS        32 // rows of text rendered into one cached tile
+#define TILE_COUNT       16 // tiles kept around, enough for a big screen of tiny text
+#define WRAP_CACHE_SIZE  8  // wrapped lines whose row starts are kept around
+#define SKIP_CACHE_BITS  10 // lines whose first glyph right of the window edge is kept around
+#define FIND_QUERY_SIZE  256
 
+// TYPES
 typedef struct {
     size_t  start;
     size_t  end;
@@ -50,17 +63,113 @@ typedef struct {
     // for UI position
     size_t row;
     size_t col;
+    size_t vrow; // visual row, the same as row unless wrapping
     int x;
     int y;
 } Cursor;
 
 typedef struct {
-    char*  items; // message string
+    char   message[256];
+    double timer;
+    double lastUpdate; // frames can be seconds apart while the editor is idle
+} Notification;
+
+typedef struct {
+    bool   active;
+    char   query[FIND_QUERY_SIZE];
+    size_t length;
+    bool   regex;
+    size_t origin;  // cursor position when the bar got opened, typing searches from there
+    size_t current; // match the cursor jumped to, SIZE_MAX when none
+    bool   jumpPending; // the query changed, jump once the first match from origin is known
+    double started;     // when the search for the current matches started
+} Find;
+
+// everything a drawn frame depends on, the window is only redrawn when it changes
+typedef struct {
+    size_t    version; // of the buffer
+    size_t    pos;
+    Selection selection;
+    int       scrollX;
+    int       scrollY;
+    int       fontSize;
+    int       width;
+    int       height;
+    bool      notification;
+} View;
+
+typedef struct {
+    float advance[GLYPH_CACHE_SIZE]; // unscaled advance of each codepoint
+    int   index[GLYPH_CACHE_SIZE];   // glyph index of each codepoint in the font
+    bool  monospace;                 // every glyph has the same advance
+    float monoAdvance;
+    float maxAdvance;                // widest glyph, bounds the width of any text
+} GlyphMetrics;
+
+// text of TILE_ROWS rows rendered once and composited while scrolling
+typedef struct {
+    RenderTexture2D target;
+    bool   valid;
+    size_t index;    // first row of the tile is index*TILE_ROWS
+    size_t lastUsed; // frame the tile was last composited in
+
+    // what the texture was rendered with
+    int fontSize;
+    int scrollX;
+    int width;
+} Tile;
+
+typedef struct {
+    Tile   items[TILE_COUNT];
+    size_t frame;
+
+    // rows edited since the tiles were rendered, dirtyTo is inclusive and
+    // SIZE_MAX when the rows after dirtyFrom got shifted
+    size_t dirtyFrom;
+    size_t dirtyTo;
+} TileCache;
+
+// rows and x range (relative to the start of the lines) uploaded as instances
+typedef struct {
+    bool   valid;
+    size_t first;
+    size_t end;
+    int    left;
+    int    right;
+    size_t version;  // of the buffer
+    int    fontSize;
+} GpuRegion;
+
+// first glyph of a line right of the left window edge, found last time it
+// was drawn. Scrolling sideways moves on from it instead of decoding the
+// line from its start again
+typedef struct {
+    size_t start;   // of the line (part), the slot is found by hashing it
+    size_t version; // of the buffer
+    size_t pos;     // of the glyph
+    size_t glyphs;  // glyphs before it
+    double advance; // their advances summed up, unscaled
+} LineSkip;
+
+// start of every visual row of a wrapped line
+typedef struct {
+    size_t *items;
     size_t size;
     size_t count;
+    size_t row;
+    size_t lastUsed;
+    bool   valid;
+} WrappedLine;
 
-    double timer;
-} Notification;
+typedef struct {
+    bool   enabled;
+    int    width;    // the visual rows were computed for this text width
+    int    fontSize; // and font size
+    size_t version;  // of the buffer, the cached lines are dropped when it changes
+
+    WrappedLine items[WRAP_CACHE_SIZE];
+    size_t      uses;
+} Wrap;
 
 typedef struct {
     Cursor c;
@@ -70,31 +179,71 @@ typedef struct {
 
     int scrollX;
     int scrollY;
+    size_t prefetchedRow; // first visible row when the viewport was last paged in
     
     const char * filename;
 
     Notification notif;
+    Find   find;
+    Search search;
 
     int fontSize;
     int fontSpacing;
     Font font;
+    GlyphMetrics metrics;
 
     int leftMargin;
+    Wrap wrap;            // soft wrapping of lines wider than the window
+    Syntax syntax;
+    double syntaxJobStart; // when the worker got the lines past the viewport
+
+    TileCache tiles;
+    GpuText   gpuText;    // instanced text, used instead of the tiles when supported
+    GpuRegion gpuRegion;
+    LineSkip  skips[1 << SKIP_CACHE_BITS];
+
+    View drawn;           // view of the last drawn frame
+    bool damaged;         // redraw even if the view did not change
+
+    Arena frame;          // transient allocations, reset every frame
+    bool  frameAllocates; // this frame may touch the heap (clipboard, file loading)
+#ifndef BUILD_RELEASE
+    size_t frameHeapAllocs; // heap allocations made before this frame
+    size_t frameVersion;    // buffer version when this frame started
+#endif
 } Editor;
 
+size_t count_digits(size_t n)
+{
+    size_t digits = 1;
+    for (; n >= 10; n /= 10) digits++;
+    return digits;
+}
+
+// writes `n` in decimal to `dest` (not null terminated), returns the length
+size_t format_size(char *dest, size_t n)
+{
+    const size_t digits = count_digits(n);
+    for (size_t i=digits; i>0; i--, n /= 10)
+        dest[i-1] = '0' + n % 10;
+    return digits;
+}
+
 void notification_update(Notification *n)
 {
     if (n->timer <= 0) 
         return;
-    n->timer -= GetFrameTime();
+    const double now = GetTime();
+    n->timer -= now - n->lastUpdate;
+    n->lastUpdate = now;
 }
 
 void notification_issue(Notification *n, const char* message, double timeout)
 {
-    da_reserve(n, strlen(message)+1);
-    strcpy(n->items, message);
+    snprintf(n->message, sizeof(n->message), "%s", message);
 
     n->timer = timeout;
+    n->lastUpdate = GetTime();
 }
 
 void notification_clear(Notification *n)
@@ -102,64 +251,434 @@ void notification_clear(Notification *n)
     n->timer = 0.0;
 }
 
-size_t cursor_get_row(Cursor *c, Lines lines)
+size_t cursor_get_row(Cursor *c, Lines *lines)
+{
+    assert(lines->count > 0);
+    return lines_find_row(lines, c->pos);
+}
+
+size_t cursor_get_col(Cursor *c, Lines *lines)
 {
-    assert(lines.count > 0);
-    for (size_t i=0; i<lines.count; i++)
+    Line currentLine = lines_get(lines, c->row);
+    return c->pos - currentLine.start;
+}
+
+// decodes the codepoint at `pos`, never reading past `end`
+int editor_codepoint_at(Editor *e, size_t pos, size_t end, int *size)
+{
+    size_t len;
+    const char *chunk = buffer_chunk(&e->buffer, pos, &len);
+    if (len >= 4 && end - pos >= 4)
+        return GetCodepointNext(chunk, size);
+
+    // the codepoint might continue in the next piece
+    char bytes[5] = {0};
+    buffer_copy(&e->buffer, pos, end - pos < 4 ? end - pos : 4, bytes);
+    return GetCodepointNext(bytes, size);
+}
+
+// unscaled advance of a glyph, the same way raylib advances when drawing text
+float font_glyph_advance(Font font, int codepoint)
+{
+    const int index = GetGlyphIndex(font, codepoint);
+    if (font.glyphs[index].advanceX != 0)
+        return font.glyphs[index].advanceX;
+    return font.recs[index].width;
+}
+
+void editor_load_metrics(Editor *e)
+{
+    GlyphMetrics *m = &e->metrics;
+    for (int i=0; i<GLYPH_CACHE_SIZE; i++)
+    {
+        m->advance[i] = font_glyph_advance(e->font, i);
+        m->index[i] = GetGlyphIndex(e->font, i);
+    }
+
+    // fonts like monogram.ttf have a fixed advance, text can be measured by
+    // counting codepoints then
+    m->monoAdvance = font_glyph_advance(e->font, e->font.glyphs[0].value);
+    m->monospace = true;
+    m->maxAdvance = 0;
+    for (int i=0; i<e->font.glyphCount; i++)
     {
-        Line line = lines.items[i];
-        if (c->pos >= line.start && c->pos <= line.end)
-            return i;
+        const float advance = font_glyph_advance(e->font, e->font.glyphs[i].value);
+        m->monospace = m->monospace && advance == m->monoAdvance;
+        if (advance > m->maxAdvance) m->maxAdvance = advance;
     }
-    // HACK: might cause bugs later?
-    // - return last line as current row
-    //   if cursor isn't found in any line
-    return lines.count - 1;
+    LOG("font is %s", m->monospace ? "monospace" : "proportional");
 }
 
-size_t cursor_get_col(Cursor *c, Lines lines)
+float editor_glyph_advance(Editor *e, int codepoint)
 {
-    Line currentLine = lines.items[c->row];
-    return c->pos - currentLine.start;
+    if (e->metrics.monospace) return e->metrics.monoAdvance;
+    if (codepoint >= 0 && codepoint < GLYPH_CACHE_SIZE) return e->metrics.advance[codepoint];
+    return font_glyph_advance(e->font, codepoint);
+}
+
+// width of the `n` bytes of text starting at `start`
+int editor_measure_text(Editor *e, size_t start, size_t n)
+{
+    if (n == 0) return 0;
+    const size_t end = start + n;
+    float width = 0;
+    size_t glyphs = 0;
+
+    if (e->metrics.monospace)
+    {   // just count the glyphs. Anything but ascii is decoded the way drawing
+        // does, invalid utf-8 is drawn as a '?' per byte
+        bool decoded = false;
+        for (size_t i=start; i<end;)
+        {
+            size_t len;
+            const char *chunk = buffer_chunk(&e->buffer, i, &len);
+            if (len > end - i) len = end - i;
+            size_t j = 0;
+            while (j < len)
+            {
+                if ((unsigned char)chunk[j] < 0x80) j++;
+                else
+                {   // may run into the next piece, the next chunk starts after it
+                    int size = 0;
+                    editor_codepoint_at(e, i + j, end, &size);
+                    j += size;
+                    decoded = true;
+                }
+                glyphs++;
+            }
+            i += j;
+        }
+        width = glyphs*e->metrics.monoAdvance;
+
+#ifndef BUILD_RELEASE
+        // the width has to be the one the glyphs get drawn with
+        if (decoded)
+        {
+            size_t drawn = 0;
+            for (size_t i=start; i<end; drawn++)
+            {
+                int size = 0;
+                editor_codepoint_at(e, i, end, &size);
+                i += size;
+            }
+            assert(drawn == glyphs && "measured width differs from the drawn one");
+        }
+#endif
+    }
+    else
+    {
+        for (size_t i=start; i<end;)
+        {
+            int size = 0;
+            width += editor_glyph_advance(e, editor_codepoint_at(e, i, end, &size));
+            glyphs++;
+            i += size;
+        }
+    }
+
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    return (int)(width*scale + (float)(glyphs - 1)*e->fontSpacing);
+}
+
+// codepoint at the start of the `n` bytes of `text`, a sequence cut short by
+// the end of the text decodes as '?' instead of being read past it
+int text_codepoint(const char *text, size_t n, int *size)
+{
+    if (n >= 4) return GetCodepointNext(text, size);
+    char bytes[5] = {0};
+    memcpy(bytes, text, n);
+    return GetCodepointNext(bytes, size);
+}
+
+// width of the `n` bytes of `text`, no terminating '\0' needed
+int editor_measure_str(Editor *e, const char *text, size_t n)
+{
+    if (n == 0) return 0;
+    float width = 0;
+    size_t glyphs = 0;
+    for (size_t i=0; i<n;)
+    {
+        int size = 0;
+        width += editor_glyph_advance(e, text_codepoint(text + i, n - i, &size));
+        glyphs++;
+        i += size;
+    }
+
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    return (int)(width*scale + (float)(glyphs - 1)*e->fontSpacing);
+}
+
+// start of the visual row after the one starting at `start`, breaking after
+// the last space that fits or else before the first glyph that does not
+size_t editor_wrap_next(Editor *e, size_t start, size_t end)
+{
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    size_t lastSpace = start;
+    float x = 0;
+    for (size_t i=start; i<end;)
+    {
+        int size = 0;
+        const int codepoint = editor_codepoint_at(e, i, end, &size);
+        const float advance = editor_glyph_advance(e, codepoint)*scale + e->fontSpacing;
+
+        // every row gets at least one glyph
+        if (x + advance > e->wrap.width && i > start)
+            return lastSpace > start ? lastSpace : i;
+        x += advance;
+        i += size;
+        if (codepoint == ' ') lastSpace = i;
+    }
+    return end;
+}
+
+// visual rows `line` needs at the current wrap width
+size_t editor_wrap_rows(Editor *e, Line line)
+{
+    // no glyph is wider than maxAdvance or shorter than a byte
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    if ((line.end - line.start)*(e->metrics.maxAdvance*scale + e->fontSpacing) <= e->wrap.width)
+        return 1;
+
+    size_t rows = 1;
+    for (size_t i=editor_wrap_next(e, line.start, line.end); i<line.end; i=editor_wrap_next(e, i, line.end))
+        rows++;
+    return rows;
+}
+
+void editor_wrap_drop(Editor *e)
+{
+    for (size_t i=0; i<WRAP_CACHE_SIZE; i++)
+        e->wrap.items[i].valid = false;
 }
 
-int editor_measure_text(Editor *e, const char *textStart, int n)
+// row starts of the wrapped line `row`, kept until the text, the width or
+// the font size change
+const WrappedLine *editor_wrapped_line(Editor *e, size_t row)
 {
-    int width = 0;
-    char *textToMeasure = malloc(sizeof(char) * (n + 1));
-    strncpy(textToMeasure, textStart, n);
-    textToMeasure[n] = '\0'; // null terminating it so MeasureText..() can detect the end
-    if (n > 0)
-        width = (int) MeasureTextEx(e->font, textToMeasure, e->fontSize, e->fontSpacing).x;
+    Wrap *w = &e->wrap;
+    if (w->version != e->buffer.version)
+    {
+        editor_wrap_drop(e);
+        w->version = e->buffer.version;
+    }
+
+    WrappedLine *line = NULL;
+    for (size_t i=0; i<WRAP_CACHE_SIZE; i++)
+    {
+        WrappedLine *it = &w->items[i];
+        if (it->valid && it->row == row)
+        {
+            it->lastUsed = ++w->uses;
+            return it;
+        }
+        if (line == NULL || !it->valid || (line->valid && it->lastUsed < line->lastUsed)) line = it;
+    }
 
-    free(textToMeasure);
-    return width;
+    const Line text = lines_get(&e->lines, row);
+    line->count = 0;
+    for (size_t i=text.start;;)
+    {
+        da_append(line, i);
+        i = editor_wrap_next(e, i, text.end);
+        if (i >= text.end) break;
+    }
+    line->row = row;
+    line->valid = true;
+    line->lastUsed = ++w->uses;
+    e->frameAllocates = true; // the row starts may have grown
+    return line;
 }
 
-int editor_measure_str(Editor *e, const char *str)
+// recomputes the visual rows of the lines [from, to]
+void editor_wrap_lines(Editor *e, size_t from, size_t to)
 {
-    int width = MeasureTextEx(e->font, str, e->fontSize, e->fontSpacing).x;
-    return width;
+    for (size_t row=from; row<=to && row<e->lines.count; row++)
+    {
+        const size_t rows = editor_wrap_rows(e, lines_get(&e->lines, row));
+        if (rows != lines_get_rows(&e->lines, row))
+            lines_set_rows(&e->lines, row, rows);
+    }
+}
+
+// keeps the visual rows in step with the text width and font size, only
+// lines too long to surely fit and lines that wrapped before get measured
+void editor_wrap_update(Editor *e)
+{
+    Wrap *w = &e->wrap;
+    if (!w->enabled) return;
+
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    const float maxAdvance = e->metrics.maxAdvance*scale + e->fontSpacing;
+    int width = GetScreenWidth() - e->leftMargin;
+    if (width < maxAdvance) width = maxAdvance;
+    if (width == w->width && e->fontSize == w->fontSize) return;
+
+    const double start = GetTime();
+    w->width = width;
+    w->fontSize = e->fontSize;
+    editor_wrap_drop(e);
+
+    const size_t fits = maxAdvance > 0 ? width/maxAdvance : SIZE_MAX;
+    size_t measured = 0;
+    for (size_t row=lines_next_long(&e->lines, 0, fits); row<e->lines.count;
+         row=lines_next_long(&e->lines, row + 1, fits))
+    {
+        editor_wrap_lines(e, row, row);
+        measured++;
+    }
+    LOG("wrapped %zu of %zu lines in %.2f ms", measured, e->lines.count, (GetTime() - start)*1000.0);
+
+    // every row below the first wrapped line may have moved
+    e->tiles.dirtyFrom = 0;
+    e->tiles.dirtyTo = SIZE_MAX;
+    e->gpuRegion.valid = false;
+    e->damaged = true;
+}
+
+void editor_wrap_toggle(Editor *e)
+{
+    Wrap *w = &e->wrap;
+    w->enabled = !w->enabled;
+    w->width = 0; // wrapped again by the next editor_wrap_update()
+    e->scrollX = 0;
+    e->tiles.dirtyFrom = 0;
+    e->tiles.dirtyTo = SIZE_MAX;
+    e->gpuRegion.valid = false;
+    e->damaged = true;
+    LOG("soft wrap %s", w->enabled ? "on" : "off");
+}
+
+// rows shown in the window, visual rows when wrapping
+size_t editor_row_count(Editor *e)
+{
+    return e->wrap.enabled ? e->lines.visual : e->lines.count;
+}
+
+// walks the shown rows: the `sub`th visual row of line `row` shows `part`
+typedef struct {
+    size_t row;
+    size_t sub;
+    size_t rows; // visual rows of the line
+    Line   line;
+    Line   part;
+} RowIter;
+
+void editor_row_load(Editor *e, RowIter *it)
+{
+    if (it->row >= e->lines.count) return;
+    it->line = lines_get(&e->lines, it->row);
+    it->rows = e->wrap.enabled ? lines_get_rows(&e->lines, it->row) : 1;
+    it->part = it->line;
+    if (it->rows <= 1) return;
+
+    const WrappedLine *w = editor_wrapped_line(e, it->row);
+    if (it->sub >= w->count)
+    {   // the visual rows are updated at the start of the next frame
+        it->part.start = it->line.end;
+        return;
+    }
+    it->part.start = w->items[it->sub];
+    if (it->sub + 1 < w->count) it->part.end = w->items[it->sub + 1];
+}
+
+RowIter editor_row_at(Editor *e, size_t vrow)
+{
+    RowIter it = {0};
+    if (vrow >= editor_row_count(e)) it.row = e->lines.count;
+    else if (e->wrap.enabled) it.row = lines_find_visual(&e->lines, vrow, &it.sub);
+    else it.row = vrow;
+    editor_row_load(e, &it);
+    return it;
+}
+
+void editor_row_next(Editor *e, RowIter *it)
+{
+    if (it->sub + 1 < it->rows)
+    {
+        it->sub++;
+    }
+    else
+    {
+        it->row++;
+        it->sub = 0;
+    }
+    editor_row_load(e, it);
+}
+
+// rows intersecting the window: [first, end)
+void editor_visible_rows(Editor *e, size_t *first, size_t *end)
+{
+    const int top = -e->scrollY / e->fontSize;
+    const int bottom = (-e->scrollY + GetScreenHeight()) / e->fontSize + 1;
+
+    *first = top > 0 ? (size_t)top : 0;
+    *end = bottom > 0 ? (size_t)bottom : 0;
+    if (*end > editor_row_count(e)) *end = editor_row_count(e);
+    if (*first > *end) *first = *end;
 }
 
 void editor_cursor_update(Editor *e)
 {
     // find current row
-    e->c.row = cursor_get_row(&e->c, e->lines);
+    e->c.row = cursor_get_row(&e->c, &e->lines);
     
     // find current col
-    e->c.col = cursor_get_col(&e->c, e->lines);
+    e->c.col = cursor_get_col(&e->c, &e->lines);
+
+    // the visual row, and where the part of the line on it starts
+    const Line currentLine = lines_get(&e->lines, e->c.row);
+    size_t rowStart = currentLine.start;
+    e->c.vrow = e->c.row;
+    if (e->wrap.enabled)
+    {
+        e->c.vrow = lines_visual_row(&e->lines, e->c.row);
+        if (lines_get_rows(&e->lines, e->c.row) > 1)
+        {   // last visual row starting at or before the cursor
+            const WrappedLine *w = editor_wrapped_line(e, e->c.row);
+            size_t lo = 0, hi = w->count;
+            while (hi - lo > 1)
+            {
+                const size_t mid = lo + (hi - lo)/2;
+                if (w->items[mid] <= e->c.pos) lo = mid;
+                else hi = mid;
+            }
+            e->c.vrow += lo;
+            rowStart = w->items[lo];
+        }
+    }
 
     // calculate cursor X and Y position on screen
     // Y position
-    e->c.y = e->c.row * e->fontSize;
+    e->c.y = e->c.vrow * e->fontSize;
 
     // X position
-    // measure the text from line start upto cursor position
-    const Line currentLine = e->lines.items[e->c.row];
-    const int requiredSize = e->c.pos - currentLine.start;
+    // measure the text from row start upto cursor position
+    const size_t requiredSize = e->c.pos - rowStart;
+
+    e->c.x = editor_measure_text(e, rowStart, requiredSize) + e->leftMargin;
+}
 
-    e->c.x = editor_measure_text(e, &e->buffer.items[currentLine.start], requiredSize) + e->leftMargin;
+// moves the cursor onto the visual row `vrow`, as close to `x` as it gets
+void editor_cursor_to_visual(Editor *e, size_t vrow, int x)
+{
+    const RowIter it = editor_row_at(e, vrow);
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    float left = 0;
+    size_t pos = it.part.start, prev = pos;
+    for (size_t i=it.part.start; i<it.part.end;)
+    {
+        int size = 0;
+        const int codepoint = editor_codepoint_at(e, i, it.part.end, &size);
+        const float advance = editor_glyph_advance(e, codepoint)*scale + e->fontSpacing;
+        if (left + advance/2 > x) break;
+        left += advance;
+        prev = i;
+        i += size;
+        pos = i;
+    }
+    // the end of a wrapped row is shown at the start of the next one
+    if (pos == it.part.end && it.part.end != it.line.end) pos = prev;
+    e->c.pos = pos;
 }
 
 void editor_cursor_right(Editor *e)
@@ -177,9 +696,15 @@ void editor_cursor_left(Editor *e)
 
 void editor_cursor_down(Editor *e)
 {
+    if (e->wrap.enabled)
+    {
+        if (e->c.vrow+1 < e->lines.visual)
+            editor_cursor_to_visual(e, e->c.vrow+1, e->c.x - e->leftMargin);
+        return;
+    }
     if (e->c.row+1 > e->lines.count - 1) return;
 
-    Line nextLine = e->lines.items[e->c.row+1];
+    Line nextLine = lines_get(&e->lines, e->c.row+1);
     size_t nextLineSize = nextLine.end - nextLine.start;
 
     if (nextLineSize >= e->c.col)
@@ -190,9 +715,15 @@ void editor_cursor_down(Editor *e)
 
 void editor_cursor_up(Editor *e)
 {
+    if (e->wrap.enabled)
+    {
+        if (e->c.vrow > 0)
+            editor_cursor_to_visual(e, e->c.vrow-1, e->c.x - e->leftMargin);
+        return;
+    }
     if (e->c.row == 0) return;
 
-    Line prevLine = e->lines.items[e->c.row-1];
+    Line prevLine = lines_get(&e->lines, e->c.row-1);
     size_t prevLineSize = prevLine.end - prevLine.start;
 
     if (prevLineSize >= e->c.col)
@@ -207,7 +738,7 @@ void editor_cursor_to_next_word(Editor *e)
 
     for (size_t i=e->c.pos; i<e->buffer.count; i++)
     {
-        const char c = e->buffer.items[i];
+        const char c = buffer_at(&e->buffer, i);
         const bool checkWhitespace = c==' ' || c=='\n';
 
         if (checkWhitespace)
@@ -221,7 +752,7 @@ void editor_cursor_to_next_word(Editor *e)
         }
     }
     // if no next word found
-    const Line line = e->lines.items[e->c.row];
+    const Line line = lines_get(&e->lines, e->c.row);
     e->c.pos = line.end;
 }
 
@@ -231,7 +762,7 @@ void editor_cursor_to_prev_word(Editor *e)
     
     for (size_t i=e->c.pos; i!=0; i--)
     {
-        const char c = e->buffer.items[i-1];
+        const char c = buffer_at(&e->buffer, i-1);
         const bool checkWhitespace = c==' ' || c=='\n';
 
         if (checkWhitespace)
@@ -245,31 +776,31 @@ void editor_cursor_to_prev_word(Editor *e)
         }
     }
     // no prev word found
-    const Line line = e->lines.items[e->c.row];
+    const Line line = lines_get(&e->lines, e->c.row);
     e->c.pos = line.start;
 }
 
 void editor_cursor_to_line_start(Editor *e)
 {
-    Line line = e->lines.items[e->c.row];
+    Line line = lines_get(&e->lines, e->c.row);
     e->c.pos = line.start;
 }
 
 void editor_cursor_to_line_end(Editor *e)
 {
-    Line line = e->lines.items[e->c.row];
+    Line line = lines_get(&e->lines, e->c.row);
     e->c.pos = line.end;
 }
 
 void editor_cursor_to_first_line(Editor *e)
 {
-    Line firstLine = e->lines.items[0];
+    Line firstLine = lines_get(&e->lines, 0);
     e->c.pos = firstLine.start;
 }
 
 void editor_cursor_to_last_line(Editor *e)
 {
-    Line lastLine = e->lines.items[e->lines.count - 1];
+    Line lastLine = lines_get(&e->lines, e->lines.count - 1);
     e->c.pos = lastLine.end;
 }
 
@@ -280,7 +811,7 @@ bool editor_cursor_to_line_number(Editor *e, size_t lineNumber)
     if (lineNumber < 1 || lineNumber >= e->lines.count) return false;
 
     size_t lineIndex = lineNumber - 1;
-    Line requiredLine = e->lines.items[lineIndex];
+    Line requiredLine = lines_get(&e->lines, lineIndex);
     e->c.pos = requiredLine.start;
     return true;
 }
@@ -289,7 +820,7 @@ void editor_cursor_to_next_empty_line(Editor *e)
 {
     for (size_t i=e->c.row+1; i<e->lines.count; i++)
     {
-        Line line = e->lines.items[i];
+        Line line = lines_get(&e->lines, i);
         size_t lineSize = line.end - line.start;
         if (lineSize == 0)
         {
@@ -298,7 +829,7 @@ void editor_cursor_to_next_empty_line(Editor *e)
         }
     }
     // move to last line if no next empty line found
-    Line lastLine = e->lines.items[e->lines.count - 1];
+    Line lastLine = lines_get(&e->lines, e->lines.count - 1);
     e->c.pos = lastLine.start;
     return;
 }
@@ -308,7 +839,7 @@ void editor_cursor_to_prev_empty_line(Editor *e)
     if (e->c.row == 0 || e->c.row >= e->lines.count) return;
     for (size_t i=e->c.row-1; i!=0; i--)
     {
-        Line line = e->lines.items[i];
+        Line line = lines_get(&e->lines, i);
         size_t lineSize = line.end - line.start;
         if (lineSize == 0)
         {
@@ -317,57 +848,63 @@ void editor_cursor_to_prev_empty_line(Editor *e)
         }
     }
     // move to first line if no previous empty line found
-    Line firstLine = e->lines.items[0];
+    Line firstLine = lines_get(&e->lines, 0);
     e->c.pos = firstLine.start;
     return;
 }
 
 void editor_calculate_lines(Editor *e)
 {
-    da_free(&e->lines);
-    Line line = {0};
-    line.start = 0;
-    for (size_t i=0; i<e->buffer.count; i++)
-    {
-        char c = e->buffer.items[i];
-        if (c == '\n')
-        {
-            line.end = i;
-            da_append(&e->lines, line);
-            line.start = i+1;
-        }
-    }
+    lines_build(&e->lines, e->buffer.pieces.items, e->buffer.pieces.count);
+}
+
+// raylib has no call to wake its event loop, this is the one of the glfw built
+// into libraylib.a for PLATFORM_DESKTOP. A raylib built for another platform
+// has no glfw, linking then fails on this symbol (used by editor_wake() only)
+void glfwPostEmptyEvent(void);
 
-    // there's always atleast one line 
-    // a lot of code depends upon that assumption
-    da_append(&e->lines, ((Line){
-        line.start,
-        e->buffer.count,
-    }));
+// wakes the event loop sleeping in EndDrawing() or PollInputEvents(), called
+// by the workers from their threads. glfw allows that from any thread between
+// glfwInit() and glfwTerminate(), the workers stop in editor_deinit() before
+// CloseWindow()
+void editor_wake(void)
+{
+    glfwPostEmptyEvent();
 }
 
 // Initialize Editor struct
 void editor_init(Editor *e)
 {
     e->c = (Cursor) {0};
-    e->buffer = (Buffer) {0};
-    da_init(&e->buffer);
-    e->lines = (Lines) {0};
-    da_init(&e->lines);
+    buffer_init(&e->buffer);
+    lines_init(&e->lines);
+    syntax_init(&e->syntax);
+    e->syntax.worker.notify = editor_wake;
+    search_init(&e->search);
+    e->search.worker.notify = editor_wake;
 
     e->scrollX = 0;
     e->scrollY = 0;
+    e->prefetchedRow = SIZE_MAX;
     
     e->filename = NULL;
 
     e->notif = (Notification) {0};
-    da_init(&e->notif);
+
+    e->damaged = true;
+    e->tiles = (TileCache) { .dirtyFrom = 0, .dirtyTo = SIZE_MAX };
+
+    arena_init(&e->frame, FRAME_ARENA_SIZE);
+    e->frameAllocates = true;
 
 #ifdef BUILD_RELEASE
     e->font = LoadFont_Font();
 #else
     e->font = LoadFont("monogram.ttf");
 #endif
+    editor_load_metrics(e);
+    if (!gpu_text_init(&e->gpuText)) LOG("instanced text not supported, using tiles");
+    e->gpuRegion = (GpuRegion) {0};
     e->fontSize = DEFAULT_FONTSIZE;
     e->fontSpacing = 0;
     SetTextLineSpacing(e->fontSize);
@@ -379,46 +916,175 @@ void editor_init(Editor *e)
 
 void editor_deinit(Editor *e)
 {
-    da_free(&e->buffer);
-    da_free(&e->lines);
-    da_free(&e->notif);
+    // the workers stop reading the text before it goes
+    syntax_free(&e->syntax);
+    search_free(&e->search);
+    buffer_free(&e->buffer);
+    lines_free(&e->lines);
+    arena_free(&e->frame);
+    gpu_text_free(&e->gpuText);
+    for (size_t i=0; i<WRAP_CACHE_SIZE; i++)
+        da_free(&e->wrap.items[i]);
+    for (size_t i=0; i<TILE_COUNT; i++)
+        if (e->tiles.items[i].target.id != 0) UnloadRenderTexture(e->tiles.items[i].target);
 #ifndef BUILD_RELEASE
     UnloadFont(e->font);
 #endif
 }
 
-void editor_insert_char_at_cursor(Editor *e, char c)
+// marks the lines [from, to] as changed for the tile cache, to = SIZE_MAX
+// when every line after `from` got shifted
+void editor_tiles_damage(Editor *e, size_t from, size_t to)
+{
+    TileCache *t = &e->tiles;
+    if (e->wrap.enabled)
+    {   // the tiles hold visual rows
+        if (to != SIZE_MAX) to = lines_visual_row(&e->lines, to) + lines_get_rows(&e->lines, to) - 1;
+        from = lines_visual_row(&e->lines, from);
+    }
+    if (from < t->dirtyFrom) t->dirtyFrom = from;
+    if (to > t->dirtyTo) t->dirtyTo = to;
+}
+
+// every edit goes through these two, they keep the line index, the wrapped
+// rows, the lexer states and the tile cache in sync with the buffer
+void editor_text_insert(Editor *e, size_t pos, const char *text, size_t n)
 {
-    da_append(&e->buffer, '\0'); // increases count by one
-    // move memory from cursor to end right by one
-    char *src = e->buffer.items + e->c.pos;
-    char *dest = src + 1;
-    size_t len = e->buffer.count - 1 - e->c.pos;
+    const size_t lineCount = e->lines.count;
+    const size_t visual = e->lines.visual;
+    buffer_insert(&e->buffer, pos, text, n);
+    lines_insert(&e->lines, pos, text, n);
+
+    const size_t row = lines_find_row(&e->lines, pos);
+    const size_t lastRow = lines_find_row(&e->lines, pos + n);
+    if (e->wrap.enabled && e->wrap.width > 0)
+        editor_wrap_lines(e, row, lastRow);
+    syntax_edit(&e->syntax, &e->lines, row, lastRow, (ptrdiff_t)e->lines.count - (ptrdiff_t)lineCount);
+    const bool shifted = e->lines.count != lineCount || e->lines.visual != visual;
+    editor_tiles_damage(e, row, shifted ? SIZE_MAX : row);
+}
 
-    memmove(dest, src, len);
-    // set the char on cursor pos
-    e->buffer.items[e->c.pos] = c;
+void editor_text_delete(Editor *e, size_t pos, size_t n)
+{
+    const size_t lineCount = e->lines.count;
+    const size_t visual = e->lines.visual;
+    buffer_delete(&e->buffer, pos, n);
+    lines_delete(&e->lines, pos, n);
+
+    const size_t row = lines_find_row(&e->lines, pos);
+    if (e->wrap.enabled && e->wrap.width > 0)
+        editor_wrap_lines(e, row, row);
+    syntax_edit(&e->syntax, &e->lines, row, row, (ptrdiff_t)e->lines.count - (ptrdiff_t)lineCount);
+    const bool shifted = e->lines.count != lineCount || e->lines.visual != visual;
+    editor_tiles_damage(e, row, shifted ? SIZE_MAX : row);
+}
 
-    // move cursor right by one character
-    e->c.pos++;
+// brings the lexer states up to the last row the tiles or the instanced text
+// may show this frame, or leaves them to the worker, and drops the tiles of
+// lines that changed color
+void editor_syntax_update(Editor *e)
+{
+    Syntax *s = &e->syntax;
+    // the worker allocates whenever it likes
+    const bool busy = syntax_busy(s);
+    if (busy) e->frameAllocates = true;
+    if (s->lang == NULL) return;
+
+    size_t first, end;
+    editor_visible_rows(e, &first, &end);
+    size_t last = end + (end - first + 1);
+    if ((end/TILE_ROWS + 1)*TILE_ROWS > last) last = (end/TILE_ROWS + 1)*TILE_ROWS;
+    if (last > editor_row_count(e)) last = editor_row_count(e);
+    const size_t endRow = last > 0 ? editor_row_at(e, last - 1).row + 1 : 0;
+
+    const double start = GetTime();
+    const size_t textSize = s->text.size;
+    const size_t lexed = syntax_update(s, &e->buffer, &e->lines, endRow);
+    if (lexed > 0)
+        LOG("lexed %zu lines in %.3f ms", lexed, (GetTime() - start)*1000.0);
+    if (s->text.size != textSize) e->frameAllocates = true;
+    if (!busy && syntax_busy(s))
+    {
+        e->frameAllocates = true;
+        e->syntaxJobStart = GetTime();
+        LOG("lexing from line %zu on the worker", s->frontier + 1);
+    }
+    else if (busy && !syntax_busy(s) && s->frontier == SIZE_MAX)
+        LOG("worker lexed the rest in %.3f ms", (GetTime() - e->syntaxJobStart)*1000.0);
 
-    editor_calculate_lines(e);
+    if (s->changedFrom <= s->changedTo)
+    {
+        if (s->changedFrom < e->lines.count)
+        {
+            const size_t to = s->changedTo < e->lines.count ? s->changedTo : e->lines.count - 1;
+            editor_tiles_damage(e, s->changedFrom, to);
+        }
+        e->gpuRegion.valid = false;
+        e->damaged = true;
+        s->changedFrom = SIZE_MAX;
+        s->changedTo = 0;
+    }
+}
+
+// colors of the glyphs of a line, asked for with increasing positions
+typedef struct {
+    const Tokens *tokens; // NULL for plain text
+    size_t lineStart;
+    size_t index;         // token the last glyph was in
+} Coloring;
+
+Coloring editor_coloring(Editor *e, size_t row, Line line)
+{
+    Coloring c = { NULL, line.start, 0 };
+    if (e->syntax.lang == NULL) return c;
+
+    const size_t tokensSize = e->syntax.tokens.size;
+    const size_t textSize = e->syntax.text.size;
+    c.tokens = syntax_line(&e->syntax, &e->buffer, &e->lines, row);
+    if (e->syntax.tokens.size != tokensSize || e->syntax.text.size != textSize)
+        e->frameAllocates = true;
+    return c;
+}
+
+Color editor_glyph_color(Coloring *c, size_t pos)
+{
+    if (c->tokens == NULL || c->tokens->count == 0) return TEXT_COLOR;
+    const size_t offset = pos - c->lineStart;
+    while (c->index + 1 < c->tokens->count && c->tokens->items[c->index + 1].start <= offset)
+        c->index++;
+
+    switch (c->tokens->items[c->index].kind)
+    {
+        case TOKEN_KEYWORD: return KEYWORD_COLOR;
+        case TOKEN_TYPE:    return TYPE_COLOR;
+        case TOKEN_STRING:  return STRING_COLOR;
+        case TOKEN_NUMBER:  return NUMBER_COLOR;
+        case TOKEN_COMMENT: return COMMENT_COLOR;
+        case TOKEN_PREPROC: return PREPROC_COLOR;
+        default:            return TEXT_COLOR;
+    }
+}
+
+// inserts `n` bytes of `text` with a single buffer and line index update
+void editor_insert_str_at_cursor(Editor *e, const char *text, size_t n)
+{
+    editor_text_insert(e, e->c.pos, text, n);
+
+    // move cursor to the end of the inserted text
+    e->c.pos += n;
+}
+
+void editor_insert_char_at_cursor(Editor *e, char c)
+{
+    editor_insert_str_at_cursor(e, &c, 1);
 }
 
 void editor_remove_char_before_cursor(Editor *e)
 {
     if (e->c.pos == 0) return;
 
-    char *src = e->buffer.items + e->c.pos;
-    char *dest = e->buffer.items + e->c.pos - 1;
-    size_t len = e->buffer.count - e->c.pos;
-    memmove(dest, src, len);
-    
-    // set cursor position & buffer count
+    editor_text_delete(e, e->c.pos - 1, 1);
     e->c.pos--;
-    e->buffer.count--;
-
-    editor_calculate_lines(e);
 }
 
 void editor_remove_char_at_cursor(Editor *e)
@@ -426,14 +1092,7 @@ void editor_remove_char_at_cursor(Editor *e)
     if (e->buffer.count == 0) return;
     if (e->c.pos > e->buffer.count - 1) return;
 
-    char *src = e->buffer.items + e->c.pos + 1;
-    char *dest = e->buffer.items + e->c.pos;
-    size_t len = e->buffer.count - (e->c.pos + 1);
-    memmove(dest, src, len);
-
-    e->buffer.count--;
-
-    editor_calculate_lines(e);
+    editor_text_delete(e, e->c.pos, 1);
 }
 
 void editor_select(Editor *e, size_t startingPos)
@@ -467,7 +1126,7 @@ void editor_selection_clear(Editor *e)
 void editor_selection_delete(Editor *e)
 {
     Selection *s = &e->selection;
-    int start, end;
+    size_t start, end;
     if (s->start <= s->end) {
         start = s->start;
         end = s->end;
@@ -476,22 +1135,16 @@ void editor_selection_delete(Editor *e)
         end = s->start;
     }
 
-    char* src = e->buffer.items + end;
-    char* dest = e->buffer.items + start;
-    size_t len = e->buffer.count - end;
-
-    memmove(dest, src, len);
+    editor_text_delete(e, start, end - start);
 
     e->c.pos = start;
-    e->buffer.count -= end - start;
     editor_selection_clear(e);
-    editor_calculate_lines(e);
 }
 
 void editor_select_all(Editor *e)
 {
-    const Line firstLine = e->lines.items[0];
-    const Line lastLine  = e->lines.items[e->lines.count - 1];
+    const Line firstLine = lines_get(&e->lines, 0);
+    const Line lastLine  = lines_get(&e->lines, e->lines.count - 1);
 
     e->selection = (Selection) {
         .start = firstLine.start,
@@ -503,7 +1156,7 @@ void editor_select_all(Editor *e)
 
 void editor_remove_word_before_cursor(Editor *e)
 {
-    int startingPos = e->c.pos;
+    const size_t startingPos = e->c.pos;
     editor_cursor_to_prev_word(e);
     editor_select(e, startingPos);
     editor_selection_delete(e);
@@ -511,7 +1164,7 @@ void editor_remove_word_before_cursor(Editor *e)
 
 void editor_remove_word_after_cursor(Editor *e)
 {
-    int startingPos = e->c.pos;
+    const size_t startingPos = e->c.pos;
     editor_cursor_to_next_word(e);
     editor_select(e, startingPos);
     editor_selection_delete(e);
@@ -519,11 +1172,14 @@ void editor_remove_word_after_cursor(Editor *e)
 
 void editor_copy(Editor *e)
 {
+    // the clipboard keeps its own copy of the text
+    e->frameAllocates = true;
+
     //get selected text or current line
     char *text = NULL;
     if (e->selection.exists)
     {
-        int start, end = 0;
+        size_t start, end = 0;
 
         if (e->selection.end > e->selection.start)
         {
@@ -536,23 +1192,22 @@ void editor_copy(Editor *e)
             end = e->selection.start;
         }
 
-        const int length = end - start;
-        text = malloc(sizeof(char) * (length + 1));
-        strncpy(text, &e->buffer.items[start], length);
+        const size_t length = end - start;
+        text = arena_alloc(&e->frame, length + 1);
+        buffer_copy(&e->buffer, start, length, text);
         text[length] = '\0';
     }
     else
     {
-        Line currentLine = e->lines.items[e->c.row];
-        const int length = currentLine.end - currentLine.start;
-        text = malloc(sizeof(char) * (length + 1));
-        strncpy(text, &e->buffer.items[currentLine.start], length);
+        Line currentLine = lines_get(&e->lines, e->c.row);
+        const size_t length = currentLine.end - currentLine.start;
+        text = arena_alloc(&e->frame, length + 1);
+        buffer_copy(&e->buffer, currentLine.start, length, text);
         text[length] = '\0';
     }
 
     //put it into clipboard lol
     SetClipboardText(text);
-    free(text);
     LOG("Copied text");
 }
 
@@ -563,7 +1218,7 @@ void editor_cut(Editor *e)
         editor_selection_delete(e);
     else
     {   // delete current line
-        Line currentLine = e->lines.items[e->c.row];
+        Line currentLine = lines_get(&e->lines, e->c.row);
         e->selection = (Selection) {
             .exists = true,
             .start  = currentLine.start,
@@ -576,13 +1231,12 @@ void editor_cut(Editor *e)
 void editor_paste(Editor *e)
 {
     const char *text = GetClipboardText();
+    if (text == NULL) return;
 
     if (e->selection.exists) 
         editor_selection_delete(e);
 
-    for (int i=0; i<strlen(text); i++)
-        editor_insert_char_at_cursor(e, text[i]);
-    // TODO: editor_insert_str_at_cursor() needed?
+    editor_insert_str_at_cursor(e, text, strlen(text));
     LOG("Pasted into editor");
 }
 
@@ -597,34 +1251,38 @@ void editor_set_font_size(Editor *e, int newFontSize)
 void editor_load_file(Editor *e, const char *filename)
 {
     LOG("Opening file: %s", filename);
+    e->frameAllocates = true;
     e->filename = filename;
     SetWindowTitle(TextFormat("%s | the bingchillin text editor", e->filename));
 
-    // get size of the file
-    FILE *f = fopen(filename, "r");
-    if (f == NULL)
+    // the workers may still be reading the old text
+    syntax_stop(&e->syntax);
+    search_stop(&e->search);
+    // the file becomes the original buffer of the piece table
+    if (!buffer_load_file(&e->buffer, filename))
     {
         perror("Error opening file");
         //exit(1);
         return;
     }
+    e->c.pos = 0;
+    const size_t size = e->buffer.count;
+    LOG("size of file(%s):%zu", filename, size);
 
-    fseek(f, 0L, SEEK_END);
-    long int size = ftell(f);
-    rewind(f); // set cursor back to beginning?
-    LOG("size of file(%s):%ld\n", filename, size);
-    
-    // allocate that much memory in the buffer
-    da_reserve(&e->buffer, (size_t)size);
-
-    // copy file's contents to buffer
-    fread(e->buffer.items, 1, size, f);
-    e->buffer.count = size;
-
-    // remember to close file
-    fclose(f);
-
+    double indexStart = GetTime();
     editor_calculate_lines(e);
+    e->tiles.dirtyFrom = 0;
+    e->tiles.dirtyTo = SIZE_MAX;
+    e->wrap.width = 0; // every line starts with one visual row
+    syntax_set_language(&e->syntax, syntax_find_language(filename));
+    LOG("highlighting as %s", e->syntax.lang != NULL ? e->syntax.lang->name : "plain text");
+    double indexTime = GetTime() - indexStart;
+    LOG("indexed %zu lines in %.2f ms (%.2f GB/s)", e->lines.count, indexTime*1000.0,
+        indexTime > 0.0 ? size/indexTime/1e9 : 0.0);
+
+    // indexing touched every page, only keep the ones around the viewport
+    buffer_release_pages(&e->buffer);
+    e->prefetchedRow = SIZE_MAX;
 }
 
 void editor_save_file(Editor *e)
@@ -635,18 +1293,69 @@ void editor_save_file(Editor *e)
         return;
     }
     notification_issue(&e->notif, TextFormat("Saving to file: %s", e->filename), 1);
+    e->frameAllocates = true;
+
+    // through a symlink, the link stays and the file it points at is saved
+    char *path = realpath(e->filename, NULL);
+    const char *target = path != NULL ? path : e->filename;
+    struct stat st;
+    const bool exists = stat(target, &st) == 0;
+
+    // the buffer may still be reading from a mapping of the file, so a new
+    // file gets written next to it and swapped in, with the mode and owner
+    // of the old one. Not when the file has other hard links, they would
+    // keep the old text
+    char tmpFilename[PATH_MAX];
+    int fd = -1;
+    if ((!exists || st.st_nlink == 1) &&
+        snprintf(tmpFilename, sizeof(tmpFilename), "%s.XXXXXX", target) < (int)sizeof(tmpFilename))
+        fd = mkstemp(tmpFilename);
+    if (fd >= 0 && exists &&
+        (fchmod(fd, st.st_mode & 07777) != 0 ||
+         ((st.st_uid != geteuid() || st.st_gid != getegid()) && fchown(fd, st.st_uid, st.st_gid) != 0)))
+    {
+        close(fd);
+        remove(tmpFilename);
+        fd = -1;
+    }
 
-    // open file for writing
-    FILE *f = fopen(e->filename, "w");
-    if (f == NULL)
+    bool saved = false;
+    if (fd >= 0)
     {
-        perror("Cannot open file for saving");
-        exit(1);
+        FILE *f = fdopen(fd, "w");
+        if (f != NULL)
+        {
+            saved = buffer_write(&e->buffer, f);
+            saved = fclose(f) == 0 && saved;
+        }
+        else close(fd);
+        saved = saved && rename(tmpFilename, target) == 0;
+        if (!saved) remove(tmpFilename);
     }
-    // write the buffer to the previously opened file
-    fwrite(e->buffer.items, 1, e->buffer.count, f);
+    else
+    {   // no new file possible (or wanted), overwrite this one like before.
+        // Its mapping has to go first, the workers may be reading from it
+        const bool searching = e->search.jobActive;
+        syntax_stop(&e->syntax);
+        search_stop(&e->search);
+        if (searching) e->search.valid = false; // looked for again from the start
+        if (buffer_unmap(&e->buffer))
+        {
+            FILE *f = fopen(target, "w");
+            if (f != NULL)
+            {
+                saved = buffer_write(&e->buffer, f);
+                saved = fclose(f) == 0 && saved;
+            }
+        }
+    }
+    free(path);
 
-    fclose(f);
+    if (!saved)
+    {
+        perror("Error while saving file");
+        notification_issue(&e->notif, TextFormat("Could not save to file: %s", e->filename), 1);
+    }
 }
 
 bool editor_key_pressed(KeyboardKey key)
@@ -654,13 +1363,310 @@ bool editor_key_pressed(KeyboardKey key)
     return IsKeyPressed(key) || IsKeyPressedRepeat(key);
 }
 
-void editor_draw_text(Editor *e, const char* text, Vector2 pos, Color color)
+typedef struct {
+    float x, y, width, height;
+    float u0, v0, u1, v1;
+} GlyphQuad;
+
+// quad of a glyph drawn at (x, y), same geometry as DrawTextCodepoint()
+GlyphQuad editor_glyph_quad(Editor *e, int codepoint, float x, float y, float scale)
+{
+    const Font *f = &e->font;
+    const int index = codepoint >= 0 && codepoint < GLYPH_CACHE_SIZE ?
+        e->metrics.index[codepoint] : GetGlyphIndex(*f, codepoint);
+    const Rectangle rec = f->recs[index];
+    const float pad = f->glyphPadding;
+
+    const float left = x + (f->glyphs[index].offsetX - pad)*scale;
+    const float top = y + (f->glyphs[index].offsetY - pad)*scale;
+    const float width = (rec.width + 2*pad)*scale;
+    const float height = (rec.height + 2*pad)*scale;
+
+    return (GlyphQuad) {
+        left, top, width, height,
+        (rec.x - pad)/f->texture.width,
+        (rec.y - pad)/f->texture.height,
+        (rec.x + rec.width + pad)/f->texture.width,
+        (rec.y + rec.height + pad)/f->texture.height,
+    };
+}
+
+// writes the quad of a glyph straight into the render batch, without the per
+// glyph lookups and state changes of DrawTextCodepoint()
+void editor_batch_glyph(Editor *e, int codepoint, float x, float y, float scale)
+{
+    const GlyphQuad q = editor_glyph_quad(e, codepoint, x, y, scale);
+
+    // flushes the batch when full, the texture and mode are kept
+    rlCheckRenderBatchLimit(4);
+    rlTexCoord2f(q.u0, q.v0); rlVertex2f(q.x, q.y);
+    rlTexCoord2f(q.u0, q.v1); rlVertex2f(q.x, q.y + q.height);
+    rlTexCoord2f(q.u1, q.v1); rlVertex2f(q.x + q.width, q.y + q.height);
+    rlTexCoord2f(q.u1, q.v0); rlVertex2f(q.x + q.width, q.y);
+}
+
+// first glyph of `line` reaching right of `edge` (x from the start of the
+// line), `x` is set to where it starts. Only the glyphs between it and the
+// one found the last time the line got drawn are decoded
+size_t editor_line_skip(Editor *e, Line line, float edge, float *x)
 {
-    DrawTextEx(e->font, text, pos, e->fontSize, e->fontSpacing, color);
+    *x = 0;
+    if (edge <= 0 || line.start == line.end) return line.start;
+
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    LineSkip *s = &e->skips[(line.start*0x9E3779B97F4A7C15ull) >> (64 - SKIP_CACHE_BITS)];
+    if (s->start != line.start || s->version != e->buffer.version || s->pos > line.end)
+        *s = (LineSkip) { .start = line.start, .version = e->buffer.version, .pos = line.start };
+
+    // back while the glyph before it (ending where it starts) reaches right
+    // of the edge too
+    while (s->pos > line.start && s->advance*scale + s->glyphs*e->fontSpacing >= edge)
+    {
+        size_t prev = s->pos - 1;
+        while (prev > line.start && (buffer_at(&e->buffer, prev) & 0xC0) == 0x80) prev--;
+        int size = 0;
+        const float advance = editor_glyph_advance(e, editor_codepoint_at(e, prev, line.end, &size));
+        if (prev + size != s->pos)
+        {   // invalid utf-8 does not decode the same way backwards
+            *s = (LineSkip) { .start = line.start, .version = e->buffer.version, .pos = line.start };
+            break;
+        }
+        s->pos = prev;
+        s->glyphs--;
+        s->advance -= advance;
+    }
+    // forward past the glyphs left of it
+    while (s->pos < line.end)
+    {
+        int size = 0;
+        const float advance = editor_glyph_advance(e, editor_codepoint_at(e, s->pos, line.end, &size));
+        if ((s->advance + advance)*scale + (s->glyphs + 1)*e->fontSpacing >= edge) break;
+        s->pos += size;
+        s->glyphs++;
+        s->advance += advance;
+    }
+    *x = s->advance*scale + s->glyphs*e->fontSpacing;
+    return s->pos;
+}
+
+// draws the `n` bytes of `text`, no terminating '\0' needed
+void editor_draw_text(Editor *e, const char *text, size_t n, Vector2 pos, Color color)
+{
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    float x = pos.x;
+
+    rlSetTexture(e->font.texture.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+
+    for (size_t i=0; i<n;)
+    {
+        int size = 0;
+        const int codepoint = text_codepoint(text + i, n - i, &size);
+        if (codepoint != ' ' && codepoint != '\t')
+            editor_batch_glyph(e, codepoint, x, pos.y, scale);
+        x += editor_glyph_advance(e, codepoint)*scale + e->fontSpacing;
+        i += size;
+    }
+
+    rlEnd();
+    rlSetTexture(0);
+}
+
+// draws the part `line` of line `row` between x = 0 and `right`
+void editor_draw_line(Editor *e, Line line, size_t row, Vector2 pos, float right)
+{
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    Coloring coloring = editor_coloring(e, row, lines_get(&e->lines, row));
+
+    // glyphs left of the window are skipped, the gutter covers the rest
+    float x;
+    const size_t first = editor_line_skip(e, line, -pos.x, &x);
+    x += pos.x;
+
+    // the whole line is one run of quads with the font texture
+    rlSetTexture(e->font.texture.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+
+    for (size_t i=first; i<line.end && x <= right;)
+    {
+        int size = 0;
+        const int codepoint = editor_codepoint_at(e, i, line.end, &size);
+        const float advance = editor_glyph_advance(e, codepoint)*scale + e->fontSpacing;
+
+        if (codepoint != ' ' && codepoint != '\t')
+        {
+            const Color color = editor_glyph_color(&coloring, i);
+            rlColor4ub(color.r, color.g, color.b, color.a);
+            editor_batch_glyph(e, codepoint, x, pos.y, scale);
+        }
+
+        x += advance;
+        i += size;
+    }
+
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void editor_find_open(Editor *e)
+{
+    Find *f = &e->find;
+    f->active = true;
+    f->origin = e->c.pos;
+    f->current = SIZE_MAX;
+    f->jumpPending = false;
+
+    // a selection on one line becomes the query
+    const Selection s = e->selection;
+    const size_t start = s.start <= s.end ? s.start : s.end;
+    const size_t stop = s.start <= s.end ? s.end : s.start;
+    if (s.exists && stop > start && stop - start < FIND_QUERY_SIZE &&
+        lines_find_row(&e->lines, start) == lines_find_row(&e->lines, stop))
+    {
+        f->length = buffer_copy(&e->buffer, start, stop - start, f->query);
+        f->origin = start;
+    }
+    e->damaged = true;
+    LOG("Find opened");
+}
+
+void editor_find_close(Editor *e)
+{
+    e->find.active = false;
+    search_clear(&e->search);
+    e->damaged = true;
+}
+
+// moves the cursor onto match `index`, the one after the last wraps around
+void editor_find_jump(Editor *e, size_t index)
+{
+    Find *f = &e->find;
+    const SearchMatches *m = &e->search.matches;
+    e->damaged = true;
+    if (m->count == 0)
+    {
+        f->current = SIZE_MAX;
+        return;
+    }
+    f->current = index % m->count;
+    e->c.pos = m->items[f->current].start;
+    editor_selection_clear(e);
+    LOG("match %zu of %zu on line %zu", f->current + 1, m->count, lines_find_row(&e->lines, e->c.pos) + 1);
+}
+
+// looks for the matches again if the query or the text changed and takes in
+// the ones the worker found, returns false when they are the same as before
+bool editor_find_update(Editor *e)
+{
+    Find *f = &e->find;
+    Search *s = &e->search;
+    if (!f->active) return false;
+
+    bool changed = false;
+    if (search_update(s, &e->buffer, f->query, f->length, f->regex))
+    {
+        f->current = SIZE_MAX;
+        f->started = GetTime();
+        changed = true;
+    }
+    if (search_take(s)) changed = true;
+
+    if (f->jumpPending)
+    {   // the cursor goes to the first match from where the search started
+        const size_t index = search_lower_bound(s, f->origin);
+        if (index < s->matches.count || !s->jobActive)
+        {
+            if (s->matches.count > 0) editor_find_jump(e, index);
+            else e->c.pos = f->origin;
+            f->jumpPending = false;
+        }
+    }
+    if (!changed) return false;
+
+    if (!s->jobActive)
+    {
+        const double seconds = GetTime() - f->started;
+        LOG("%zu matches, looked at %zu bytes in %.3f ms (%.2f GB/s)", s->matches.count,
+            s->looked, seconds*1000.0, seconds > 0 ? s->looked/seconds/1e9 : 0.0);
+    }
+    e->frameAllocates = true; // the matches may have grown
+    e->damaged = true;
+    return true;
+}
+
+// typing into the find bar, Enter and Shift Enter go through the matches,
+// Ctrl R switches between a literal and a regex query, Ctrl V pastes the first
+// line of the clipboard into the query
+void editor_find_keys(Editor *e)
+{
+    Find *f = &e->find;
+    const size_t length = f->length;
+
+    int key;
+    while ((key = GetCharPressed()) != 0)
+    {
+        int size = 0;
+        const char *utf8 = CodepointToUTF8(key, &size);
+        if (f->length + size > FIND_QUERY_SIZE) continue;
+        memcpy(f->query + f->length, utf8, size);
+        f->length += size;
+    }
+    if (editor_key_pressed(KEY_BACKSPACE))
+    {   // drops the last codepoint
+        while (f->length > 0 && (f->query[--f->length] & 0xC0) == 0x80);
+    }
+    if (IsKeyDown(KEY_LEFT_CONTROL) && editor_key_pressed(KEY_V))
+    {
+        // the clipboard keeps its own copy of the text
+        e->frameAllocates = true;
+        const char *text = GetClipboardText();
+        if (text != NULL)
+        {
+            size_t n = strcspn(text, "\r\n");
+            if (n > FIND_QUERY_SIZE - f->length)
+            {   // as much as fits, without cutting a codepoint in half
+                n = FIND_QUERY_SIZE - f->length;
+                while (n > 0 && (text[n] & 0xC0) == 0x80) n--;
+            }
+            memcpy(f->query + f->length, text, n);
+            f->length += n;
+        }
+    }
+    if (IsKeyDown(KEY_LEFT_CONTROL) && IsKeyPressed(KEY_R))
+    {
+        f->regex = !f->regex;
+        f->jumpPending = true;
+        e->damaged = true;
+    }
+    // the jump happens in editor_find_update(), when the matches are known
+    if (f->length != length) f->jumpPending = true;
+
+    const size_t count = e->search.matches.count;
+    if (editor_key_pressed(KEY_ENTER) && count > 0 && !f->jumpPending)
+    {
+        size_t next = f->current + 1;
+        size_t prev = f->current + count - 1;
+        if (f->current == SIZE_MAX)
+        {   // the matches changed since the last jump, go on from the cursor
+            next = search_lower_bound(&e->search, e->c.pos + 1);
+            prev = search_lower_bound(&e->search, e->c.pos) + count - 1;
+        }
+        editor_find_jump(e, IsKeyDown(KEY_LEFT_SHIFT) ? prev : next);
+    }
 }
 
 bool editor_update(Editor *e)
 {
+#ifndef BUILD_RELEASE
+    e->frameHeapAllocs = arena_heap_allocs();
+    e->frameVersion = e->buffer.version;
+    // the search worker allocates until it stops, also after a cancel
+    if (search_busy(&e->search)) e->frameAllocates = true;
+#endif
+
     if (IsKeyDown(KEY_LEFT_CONTROL))
     {
         if (editor_key_pressed(KEY_EQUAL))
@@ -670,15 +1676,21 @@ bool editor_update(Editor *e)
             editor_set_font_size(e, e->fontSize - 1);
 
         if (IsKeyPressed(KEY_A)) editor_select_all(e);
+        if (IsKeyPressed(KEY_F)) editor_find_open(e);
 
         if (IsKeyPressed(KEY_S)) editor_save_file(e);
         if (IsKeyPressed(KEY_Q)) return true;
 
         if (IsKeyPressed(KEY_C)) editor_copy(e);
-        if (IsKeyPressed(KEY_X)) editor_cut(e);
-        if (editor_key_pressed(KEY_V)) editor_paste(e);
+        if (IsKeyPressed(KEY_X) && !e->find.active) editor_cut(e);
+        if (editor_key_pressed(KEY_V) && !e->find.active) editor_paste(e);
     }
 
+    if (IsKeyDown(KEY_LEFT_ALT) && IsKeyPressed(KEY_Z)) editor_wrap_toggle(e);
+    // the find bar takes the typed text, Enter, Backspace and pasting, the
+    // keys editing the buffer (Tab, Delete, Ctrl X) do nothing while it is open
+    if (e->find.active) editor_find_keys(e);
+
     // -------------------
     // Movement stuff
     size_t startingPos = e->c.pos;
@@ -754,34 +1766,39 @@ bool editor_update(Editor *e)
     // Movement stuff ends
     // -------------------
 
-    if (editor_key_pressed(KEY_ENTER))
+    if (editor_key_pressed(KEY_ENTER) && !e->find.active)
     {
         LOG("Enter key pressed");
         if (e->selection.exists) editor_selection_delete(e);
         // finds number of spaces on current line
-        int spaces = 0;
+        // NOTE: the cursor row is stale if a selection just got deleted
+        size_t spaces = 0;
         {
-            const Line currentLine = e->lines.items[e->c.row];
-            for (; e->buffer.items[currentLine.start + spaces] == ' '; spaces++);
+            const Line currentLine = lines_get(&e->lines, lines_find_row(&e->lines, e->c.pos));
+            for (; currentLine.start + spaces < currentLine.end &&
+                   buffer_at(&e->buffer, currentLine.start + spaces) == ' '; spaces++);
         }
         // puts same amount of spaces on the new line
-        editor_insert_char_at_cursor(e, '\n');
-        for (int i = 0; i<spaces; i++) editor_insert_char_at_cursor(e, ' ');
+        char *text = arena_alloc(&e->frame, spaces + 1);
+        text[0] = '\n';
+        memset(text + 1, ' ', spaces);
+        editor_insert_str_at_cursor(e, text, spaces + 1);
     }
 
-    if (IsKeyPressed(KEY_TAB))
+    if (IsKeyPressed(KEY_TAB) && !e->find.active)
     {   // TODO: implement proper tab behaviour
         LOG("Tab key pressed");
-        for (int i=0; i<4; i++) editor_insert_char_at_cursor(e, ' ');
+        editor_insert_str_at_cursor(e, "    ", 4);
     }
 
     if (IsKeyPressed(KEY_ESCAPE))
     {
+        if (e->find.active) editor_find_close(e);
         editor_selection_clear(e);
         notification_clear(&e->notif);
     }
 
-    if (editor_key_pressed(KEY_BACKSPACE))
+    if (editor_key_pressed(KEY_BACKSPACE) && !e->find.active)
     {
         LOG("Backspace pressed");
         if (e->selection.exists)
@@ -792,7 +1809,7 @@ bool editor_update(Editor *e)
             editor_remove_char_before_cursor(e);
     }
 
-    if (editor_key_pressed(KEY_DELETE))
+    if (editor_key_pressed(KEY_DELETE) && !e->find.active)
     {
         LOG("Delete pressed");
         if (e->selection.exists)
@@ -803,14 +1820,34 @@ bool editor_update(Editor *e)
             editor_remove_char_at_cursor(e);
     }
 
-    char key = GetCharPressed();
-    if (key) {
-        LOG("%c - character pressed", key);
-        if (e->selection.exists) editor_selection_delete(e);
-        editor_insert_char_at_cursor(e, key);
+    { // drain every character typed since last frame and insert them as one edit
+        char typed[64];
+        size_t typedCount = 0;
+        int key;
+        while ((key = GetCharPressed()) != 0)
+        {
+            LOG("U+%04X - character pressed", key);
+            int size = 0;
+            const char *utf8 = CodepointToUTF8(key, &size);
+            if (typedCount + size > sizeof(typed))
+            {
+                if (e->selection.exists) editor_selection_delete(e);
+                editor_insert_str_at_cursor(e, typed, typedCount);
+                typedCount = 0;
+            }
+            memcpy(typed + typedCount, utf8, size);
+            typedCount += size;
+        }
+        if (typedCount > 0)
+        {
+            if (e->selection.exists) editor_selection_delete(e);
+            editor_insert_str_at_cursor(e, typed, typedCount);
+        }
     }
 
     notification_update(&e->notif);
+    editor_find_update(e); // the text or the query may have changed, the worker may have found more
+    editor_wrap_update(e);
     
     { // Update Editor members
         editor_cursor_update(e);
@@ -823,12 +1860,14 @@ bool editor_update(Editor *e)
         const int winWidth = GetScreenWidth();
         const int winHeight = GetScreenHeight();
 
-        // X offset calculation
+        // X offset calculation, wrapped text always fits
         const int cursorX = e->c.x;
         const int winRight = winWidth - e->scrollX;
         const int winLeft = 0 - e->scrollX + e->leftMargin;
 
-        if ( cursorX > winRight )
+        if (e->wrap.enabled)
+            e->scrollX = 0;
+        else if ( cursorX > winRight )
             e->scrollX = winWidth-cursorX-1;
         else if ( cursorX < winLeft )
             e->scrollX = -cursorX + e->leftMargin;
@@ -844,80 +1883,308 @@ bool editor_update(Editor *e)
         else if (cursorTop < winTop)
             e->scrollY = -cursorTop;
     }
+
+    { // page in the text around the viewport, one screen above and below
+        size_t first, end;
+        editor_visible_rows(e, &first, &end);
+        if (first != e->prefetchedRow && end > first)
+        {
+            const size_t rows = end - first;
+            const size_t from = first > rows ? first - rows : 0;
+            const size_t to = end + rows < editor_row_count(e) ? end + rows : editor_row_count(e);
+            const size_t start = editor_row_at(e, from).part.start;
+            buffer_prefetch(&e->buffer, start, editor_row_at(e, to - 1).part.end - start);
+            e->prefetchedRow = first;
+        }
+    }
+    editor_syntax_update(e);
     return 0;
 }
 
+// returns the tile holding rows [index*TILE_ROWS, (index+1)*TILE_ROWS) rendered
+// for the current font size, scroll and width, or NULL when every tile is in use
+Tile *editor_tile_get(Editor *e, size_t index, int width)
+{
+    TileCache *t = &e->tiles;
+    Tile *tile = NULL;
+    for (size_t i=0; i<TILE_COUNT; i++)
+    {
+        Tile *it = &t->items[i];
+        if (it->valid && it->index == index) { tile = it; break; }
+        // least recently used one gets reused, never one composited this frame
+        if (it->lastUsed == t->frame) continue;
+        if (tile == NULL || !it->valid || (tile->valid && it->lastUsed < tile->lastUsed)) tile = it;
+    }
+    if (tile == NULL) return NULL;
+
+    const int height = TILE_ROWS * e->fontSize;
+    bool valid = tile->valid && tile->index == index && tile->fontSize == e->fontSize &&
+                 tile->scrollX == e->scrollX && tile->width == width;
+    tile->lastUsed = t->frame;
+    if (valid) return tile;
+
+    if (tile->target.id == 0 || tile->target.texture.width != width || tile->target.texture.height != height)
+    {
+        if (tile->target.id != 0) UnloadRenderTexture(tile->target);
+        tile->target = LoadRenderTexture(width, height);
+    }
+    tile->valid = true;
+    tile->index = index;
+    tile->fontSize = e->fontSize;
+    tile->scrollX = e->scrollX;
+    tile->width = width;
+
+    BeginTextureMode(tile->target);
+    ClearBackground(BG_COLOR);
+    const size_t first = index * TILE_ROWS;
+    RowIter it = editor_row_at(e, first);
+    for (size_t i=first; i<first + TILE_ROWS && i<editor_row_count(e); i++, editor_row_next(e, &it))
+    {
+        Vector2 pos = { e->scrollX, (int)(e->fontSize*(i - first)) };
+        editor_draw_line(e, it.part, it.row, pos, width);
+    }
+    EndTextureMode();
+    return tile;
+}
+
+// uploads the glyphs of the viewport and one screen around it as instances,
+// nothing is uploaded while the viewport stays inside that region
+void editor_gpu_text_update(Editor *e)
+{
+    GpuRegion *r = &e->gpuRegion;
+    size_t first, end;
+    editor_visible_rows(e, &first, &end);
+    const int width = GetScreenWidth() - e->leftMargin;
+    const int left = -e->scrollX;
+    const int right = left + width;
+
+    if (r->valid && r->version == e->buffer.version && r->fontSize == e->fontSize &&
+        first >= r->first && end <= r->end && left >= r->left && right <= r->right)
+        return;
+
+    const size_t rows = end - first + 1;
+    r->first = first > rows ? first - rows : 0;
+    r->end = end + rows < editor_row_count(e) ? end + rows : editor_row_count(e);
+    r->left = left - width;
+    r->right = right + width;
+    r->version = e->buffer.version;
+    r->fontSize = e->fontSize;
+    r->valid = true;
+
+    const float scale = (float)e->fontSize/e->font.baseSize;
+    gpu_text_clear(&e->gpuText);
+    RowIter it = editor_row_at(e, r->first);
+    for (size_t row=r->first; row<r->end; row++, editor_row_next(e, &it))
+    {
+        const Line line = it.part;
+        const float y = (int)(e->fontSize*(row - r->first));
+        float x;
+        Coloring coloring = editor_coloring(e, it.row, it.line);
+        for (size_t i=editor_line_skip(e, line, r->left, &x); i<line.end && x <= r->right;)
+        {
+            int size = 0;
+            const int codepoint = editor_codepoint_at(e, i, line.end, &size);
+            const float advance = editor_glyph_advance(e, codepoint)*scale + e->fontSpacing;
+
+            if (codepoint != ' ' && codepoint != '\t')
+            {
+                const GlyphQuad q = editor_glyph_quad(e, codepoint, x - r->left, y, scale);
+                const Color color = editor_glyph_color(&coloring, i);
+                gpu_text_push(&e->gpuText, (GlyphInstance) {
+                    q.x, q.y, q.width, q.height, q.u0, q.v0, q.u1, q.v1,
+                    { color.r, color.g, color.b, color.a },
+                });
+            }
+            x += advance;
+            i += size;
+        }
+    }
+    gpu_text_upload(&e->gpuText);
+    e->frameAllocates = true; // the staging array may have grown
+}
+
+// drops the tiles showing rows edited since the last frame
+void editor_tiles_update(Editor *e)
+{
+    TileCache *t = &e->tiles;
+    t->frame++;
+    if (t->dirtyFrom > t->dirtyTo) return;
+
+    for (size_t i=0; i<TILE_COUNT; i++)
+    {
+        Tile *tile = &t->items[i];
+        const size_t first = tile->index * TILE_ROWS;
+        if (tile->valid && first + TILE_ROWS > t->dirtyFrom && first <= t->dirtyTo)
+            tile->valid = false;
+    }
+    t->dirtyFrom = SIZE_MAX;
+    t->dirtyTo = 0;
+}
+
+View editor_view(Editor *e)
+{
+    return (View) {
+        .version      = e->buffer.version,
+        .pos          = e->c.pos,
+        .selection    = e->selection,
+        .scrollX      = e->scrollX,
+        .scrollY      = e->scrollY,
+        .fontSize     = e->fontSize,
+        .width        = GetScreenWidth(),
+        .height       = GetScreenHeight(),
+        .notification = e->notif.timer > 0.0,
+    };
+}
+
+// true when the window shows something else than the last drawn frame
+bool editor_needs_redraw(Editor *e)
+{
+    const View view = editor_view(e);
+    const View old = e->drawn;
+    const bool selectionChanged = view.selection.exists != old.selection.exists ||
+        (view.selection.exists && (view.selection.start != old.selection.start ||
+                                   view.selection.end != old.selection.end));
+
+    bool damaged = e->damaged || selectionChanged || IsWindowResized();
+    damaged = damaged || view.version != old.version || view.pos != old.pos;
+    damaged = damaged || view.scrollX != old.scrollX || view.scrollY != old.scrollY;
+    damaged = damaged || view.fontSize != old.fontSize;
+    damaged = damaged || view.width != old.width || view.height != old.height;
+    // a running notification timer redraws every frame, and once more to hide it
+    damaged = damaged || view.notification || old.notification;
+
+    e->drawn = view;
+    e->damaged = false;
+    return damaged;
+}
+
 void editor_draw(Editor *e)
 {
+        // nothing allocated last frame is used anymore
+        arena_reset(&e->frame);
+        editor_tiles_update(e);
+
+        // tiles are (re)rendered before the frame starts, then composited
+        size_t first, end;
+        editor_visible_rows(e, &first, &end);
+        const int textWidth = GetScreenWidth() - e->leftMargin;
+        const bool instanced = e->gpuText.ok;
+        Tile *tiles[TILE_COUNT] = {0};
+        const size_t firstTile = first / TILE_ROWS;
+        if (instanced) editor_gpu_text_update(e);
+        // only the tiles the visible rows fall in, however far down the buffer
+        for (size_t index=firstTile; index*TILE_ROWS < end && index - firstTile < TILE_COUNT && textWidth > 0 && !instanced; index++)
+            tiles[index - firstTile] = editor_tile_get(e, index, textWidth);
+
         BeginDrawing();
         ClearBackground(BG_COLOR);
 
-        { // Render Text Buffer
-            // null terminate buffer before drawing it
-            da_append(&e->buffer, '\0');
-
-            Vector2 pos = {
-                e->leftMargin+e->scrollX, 
-                0+e->scrollY,
+        if (instanced)
+        {   // scrolling only moves the uploaded glyphs around
+            const GpuRegion *r = &e->gpuRegion;
+            const Vector2 offset = {
+                e->leftMargin + e->scrollX + r->left,
+                (int)(e->fontSize*r->first) + e->scrollY,
             };
-            editor_draw_text(e, e->buffer.items, pos, TEXT_COLOR);
-            // remove \0
-            da_remove(&e->buffer);
+            gpu_text_draw(&e->gpuText, e->font.texture, offset);
+        }
+        else
+        { // Render Text Buffer
+            // only the lines inside the window, from the tiles where possible
+            for (size_t i=first; i<end;)
+            {
+                const size_t index = i / TILE_ROWS;
+                const Tile *tile = index - firstTile < TILE_COUNT ? tiles[index - firstTile] : NULL;
+                if (tile != NULL)
+                {
+                    // render textures are upside down
+                    const Rectangle src = { 0, 0, tile->width, -(float)tile->target.texture.height };
+                    const Vector2 pos = { e->leftMargin, (int)(e->fontSize*index*TILE_ROWS) + e->scrollY };
+                    DrawTextureRec(tile->target.texture, src, pos, WHITE);
+                    i = (index + 1) * TILE_ROWS;
+                    continue;
+                }
+                Vector2 pos = {
+                    e->leftMargin+e->scrollX,
+                    (int)(e->fontSize*i) + e->scrollY,
+                };
+                const RowIter it = editor_row_at(e, i);
+                editor_draw_line(e, it.part, it.row, pos, GetScreenWidth());
+                i++;
+            }
         }
 
         { // Render selection
+            // only the rows that are both selected and inside the window
             const Selection s = e->selection;
 
-            if (s.exists) {
-                size_t start, end = 0;
-                if (s.start <= s.end) {
-                    start = s.start;
-                    end = s.end;
-                }
-                else {
-                    start = s.end;
-                    end = s.start;
-                }
-
-                bool selectionFound = false;
+            size_t first, end;
+            editor_visible_rows(e, &first, &end);
+            if (s.exists && first < end) {
+                const size_t start = s.start <= s.end ? s.start : s.end;
+                const size_t stop = s.start <= s.end ? s.end : s.start;
 
-                for (size_t i=0; i<e->lines.count; i++)
+                const Color color = ColorAlpha(SELECTION_COLOR, SELECTION_ALPHA);
+                RowIter it = editor_row_at(e, first);
+                for (size_t row=first; row<end; row++, editor_row_next(e, &it))
                 {
-                    const Line line = e->lines.items[i];
-
-                    Rectangle rect = {
-                        .height = e->fontSize,
-                        .width = editor_measure_text(e, &e->buffer.items[line.start], line.end - line.start),
-                        .x = 0,
-                        .y = (int)i * e->fontSize,
-                    };
-                    bool startInLine = false;
-                    if (start >= line.start && start <= line.end)
-                    {
-                        startInLine = selectionFound = true;
-                        int chars = abs((int)line.start - (int)start);
-                        rect.x = editor_measure_text(e, &e->buffer.items[line.start], chars);
-                        rect.width = rect.width - rect.x;
-                    }
+                    const Line part = it.part;
+                    if (stop < part.start) break;
+                    if (start > part.end) continue;
+                    const size_t from = start > part.start ? start : part.start;
+                    const size_t to = stop < part.end ? stop : part.end;
+
+                    const int x = editor_measure_text(e, part.start, from - part.start);
+                    int width = editor_measure_text(e, from, to - from);
+                    if (part.end == it.line.end && stop > part.end) // the selected '\n' shows as one space
+                        width += editor_measure_str(e, " ", 1);
+
+                    DrawRectangle(x + e->scrollX + e->leftMargin, (int)(e->fontSize*row) + e->scrollY,
+                                  width, e->fontSize, color);
+                }
+            }
+        }
 
-                    if (end >= line.start && end <= line.end)
-                    {
-                        if (startInLine) {
-                            int chars = end - start;
-                            rect.width = editor_measure_text(e, &e->buffer.items[start], chars);
-                        }
-                        else {
-                            int chars = abs((int)line.start - (int)end);
-                            rect.width = editor_measure_text(e, &e->buffer.items[line.start], chars);
-                        }
-                    }
+        { // Render find matches
+            // only the rows inside the window, left to right until the window ends
+            const Search *s = &e->search;
+            const size_t count = s->matches.count;
+            const size_t length = s->longest;
 
-                    if (line.start > end || line.end < start)
-                        selectionFound = false;
+            size_t first, end;
+            editor_visible_rows(e, &first, &end);
+            if (e->find.active && count > 0 && first < end)
+            {
+                RowIter it = editor_row_at(e, first);
+                // a match starting before the first row may still reach into it
+                size_t i = search_lower_bound(&e->search, it.part.start >= length ? it.part.start - length + 1 : 0);
+                for (size_t row=first; row<end && i<count; row++, editor_row_next(e, &it))
+                {
+                    const Line part = it.part;
+                    const bool last = part.end == it.line.end; // the '\n' is shown on this row
+                    for (; i < count && s->matches.items[i].end <= part.start; i++);
 
-                    if (selectionFound)
+                    size_t measured = part.start;
+                    int x = 0;
+                    for (size_t j=i; j<count; j++)
                     {
-                        DrawRectangleLines(rect.x + e->scrollX + e->leftMargin, rect.y + e->scrollY, rect.width, rect.height, SELECTION_COLOR);
+                        const size_t start = s->matches.items[j].start;
+                        const size_t stop = s->matches.items[j].end;
+                        if (start > part.end || (start == part.end && !(last && stop > part.end))) break;
+
+                        const size_t from = start > part.start ? start : part.start;
+                        const size_t to = stop < part.end ? stop : part.end;
+                        // measured in steps, the spacing after the previous step goes in too
+                        if (from > measured)
+                            x += editor_measure_text(e, measured, from - measured) + (measured > part.start ? e->fontSpacing : 0);
+                        measured = from;
+                        if (x + e->scrollX > GetScreenWidth()) break;
+
+                        int width = editor_measure_text(e, from, to - from);
+                        if (last && stop > part.end) width += editor_measure_str(e, " ", 1);
+                        const float alpha = j == e->find.current ? CURRENT_MATCH_ALPHA : MATCH_ALPHA;
+                        DrawRectangle(x + e->scrollX + e->leftMargin, (int)(e->fontSize*row) + e->scrollY,
+                                      width, e->fontSize, ColorAlpha(MATCH_COLOR, alpha));
                     }
                 }
             }
@@ -930,30 +2197,64 @@ void editor_draw(Editor *e)
             // draw vertical line seperating the line nums
             DrawLine(e->leftMargin-1, 0, e->leftMargin-1, GetScreenHeight(), UI_COLOR);
             
-            // the line numbers
-            const char *strLineNum;
-            for (size_t i=0; i<e->lines.count; i++)
+            // the line numbers, only the visible ones
+            size_t first, end;
+            editor_visible_rows(e, &first, &end);
+            RowIter it = editor_row_at(e, first);
+            for (size_t i=first; i<end; i++, editor_row_next(e, &it))
             {
-                strLineNum = TextFormat("%lu", i+1);
+                if (it.sub > 0) continue; // wrapped rows go without a number
+                char strLineNum[24];
+                const size_t length = format_size(strLineNum, it.row+1);
                 Vector2 pos = {
                     0,
                     (int)(e->fontSize*i) + e->scrollY,
                     // NOTE: i being size_t causes HUGE(obviously) underflow on line 0 when scrollY < 0
                     // -  solution cast to (int): may cause issue later (pain) :( 
                 };
-                editor_draw_text(e, strLineNum, pos, UI_COLOR);
+                editor_draw_text(e, strLineNum, length, pos, UI_COLOR);
             }
-            e->leftMargin = strlen(strLineNum) + 2;
-            e->leftMargin *= editor_measure_str(e, "a");
+            // wide enough for the biggest line number
+            e->leftMargin = count_digits(e->lines.count) + 2;
+            e->leftMargin *= editor_measure_str(e, "a", 1);
         }
 
         { // Render cursor (atleast trying to)
             DrawLine(e->c.x + e->scrollX + 1, e->c.y + e->scrollY, e->c.x + e->scrollX + 1, e->c.y + e->scrollY + e->fontSize, CURSOR_COLOR);
         }
 
+        if (e->find.active)
+        { // Render find bar at the bottom of the window
+            const Find *f = &e->find;
+            const Search *s = &e->search;
+            const int padding = 5;
+            const int height = e->fontSize + 2*padding;
+            const int top = GetScreenHeight() - height;
+            DrawRectangle(0, top, GetScreenWidth(), height, BG_COLOR);
+            DrawLine(0, top, GetScreenWidth(), top, UI_COLOR);
+
+            // the query is drawn straight from the find bar, after the label
+            const char *label = f->regex ? "Regex: " : "Find: ";
+            const Vector2 labelPos = { padding, top + padding };
+            editor_draw_text(e, label, strlen(label), labelPos, UI_COLOR);
+            const Vector2 queryPos = { labelPos.x + editor_measure_str(e, label, strlen(label)) + e->fontSpacing, labelPos.y };
+            editor_draw_text(e, f->query, f->length, queryPos, UI_COLOR);
+
+            // "+" while there may be more
+            const char *more = s->complete && !s->jobActive ? "" : "+";
+            const char *matches = s->error[0] != '\0' ? s->error
+                : f->current == SIZE_MAX
+                ? TextFormat("%zu%s matches", s->matches.count, more)
+                : TextFormat("%zu/%zu%s", f->current + 1, s->matches.count, more);
+            const size_t length = strlen(matches);
+            const Vector2 countPos = { GetScreenWidth() - padding - editor_measure_str(e, matches, length), top + padding };
+            editor_draw_text(e, matches, length, countPos, UI_COLOR);
+        }
+
         // Render Notification
         if (e->notif.timer > 0.0) {
-            int textW = editor_measure_str(e, e->notif.items);
+            const size_t length = strlen(e->notif.message);
+            int textW = editor_measure_str(e, e->notif.message, length);
             int textH = e->fontSize;
 
             Vector2 textPos = {
@@ -965,10 +2266,17 @@ void editor_draw(Editor *e)
             DrawRectangle(textPos.x-padding, textPos.y-padding, textW+(padding*2), textH+(padding*2), BG_COLOR);
             DrawRectangleLines(textPos.x-padding, textPos.y-padding, textW+(padding*2), textH+(padding*2), CURSOR_COLOR);
             // render notification message
-            editor_draw_text(e, e->notif.items, textPos, CURSOR_COLOR);
+            editor_draw_text(e, e->notif.message, length, textPos, CURSOR_COLOR);
         }
 
         EndDrawing();
+
+#ifndef BUILD_RELEASE
+        // idle and scrolling frames must not touch the heap
+        if (!e->frameAllocates && e->buffer.version == e->frameVersion)
+            assert(arena_heap_allocs() == e->frameHeapAllocs && "heap allocation in a frame without edits");
+#endif
+        e->frameAllocates = false;
 }
 
 int main(int argc, char **argv)
@@ -982,7 +2290,7 @@ int main(int argc, char **argv)
     SetWindowState(FLAG_WINDOW_RESIZABLE); // HACK: not fully tested with resizing enabled
                                            // might cause some bugs
     SetExitKey(KEY_NULL);
-    SetTargetFPS(60);
+    SetTargetFPS(TARGET_FPS);
 
     Editor editor = {0};
 
@@ -992,11 +2300,43 @@ int main(int argc, char **argv)
         editor_load_file(&editor, argv[1]);
     }
     
+#ifndef BUILD_RELEASE
+    size_t wakeups = 0, redraws = 0;
+    double statsStart = GetTime();
+#endif
     bool shouldQuit = false;
     while(!WindowShouldClose() && !shouldQuit)
     {
         shouldQuit = editor_update(&editor);
-        editor_draw(&editor);
+
+        // sleep until the next input event unless a notification is counting
+        // down, the workers wake the loop themselves when they bring in
+        // colors or matches
+        const bool polling = editor.notif.timer > 0.0;
+        if (polling) DisableEventWaiting();
+        else EnableEventWaiting();
+
+        const bool redraw = editor_needs_redraw(&editor);
+        if (redraw) editor_draw(&editor); // EndDrawing() waits for the next event, or frame when polling
+        else
+        {
+            PollInputEvents(); // nothing changed, just wait for the next event
+            // nothing waits when polling, hold the loop back to the frame rate
+            // instead of spinning
+            if (polling) WaitTime(1.0/TARGET_FPS);
+        }
+
+#ifndef BUILD_RELEASE
+        wakeups++;
+        redraws += redraw;
+        const double now = GetTime();
+        if (now - statsStart >= 1.0)
+        {   // counted when the editor wakes up, a long sleep shows up as a low rate
+            LOG("%.2f wakeups/s, %.2f redraws/s", wakeups/(now - statsStart), redraws/(now - statsStart));
+            wakeups = redraws = 0;
+            statsStart = now;
+        }
+#endif
     }
 
     editor_deinit(&editor);
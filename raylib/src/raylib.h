@@ -1463,6 +1463,8 @@ RLAPI bool rlExportFontAsCode(rlFont font, const char *fileName);
 RLAPI void rlDrawFPS(int posX, int posY);                                                     // Draw current FPS
 RLAPI void rlDrawText(const char *text, int posX, int posY, int fontSize, rlColor color);       // Draw text (using default font)
 RLAPI void rlDrawTextEx(rlFont font, const char *text, rlVector2 position, float fontSize, float spacing, rlColor tint); // Draw text using font and additional parameters
+RLAPI void rlDrawTextN(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, rlColor tint); // Draw first length bytes of text (no NULL terminator required)
+RLAPI void rlDrawTextClipN(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, rlRectangle clip, rlColor tint); // Draw first length bytes of text, skipping glyphs outside clip rectangle
 RLAPI void rlDrawTextPro(rlFont font, const char *text, rlVector2 position, rlVector2 origin, float rotation, float fontSize, float spacing, rlColor tint); // Draw text using rlFont and pro parameters (rotation)
 RLAPI void rlDrawTextCodepoint(rlFont font, int codepoint, rlVector2 position, float fontSize, rlColor tint); // Draw one character (codepoint)
 RLAPI void rlDrawTextCodepoints(rlFont font, const int *codepoints, int codepointCount, rlVector2 position, float fontSize, float spacing, rlColor tint); // Draw multiple character (codepoint)
@@ -1471,6 +1473,7 @@ RLAPI void rlDrawTextCodepoints(rlFont font, const int *codepoints, int codepoin
 RLAPI void rlSetTextLineSpacing(int spacing);                                                 // Set vertical line spacing when drawing with line-breaks
 RLAPI int rlMeasureText(const char *text, int fontSize);                                      // Measure string width for default font
 RLAPI rlVector2 rlMeasureTextEx(rlFont font, const char *text, float fontSize, float spacing);    // Measure string size for rlFont
+RLAPI rlVector2 rlMeasureTextN(rlFont font, const char *text, int length, float fontSize, float spacing); // Measure size of first length bytes of text (no NULL terminator required)
 RLAPI int rlGetGlyphIndex(rlFont font, int codepoint);                                          // Get glyph index position in font for a codepoint (unicode character), fallback to '?' if not found
 RLAPI rlGlyphInfo rlGetGlyphInfo(rlFont font, int codepoint);                                     // Get glyph font info data for a codepoint (unicode character), fallback to '?' if not found
 RLAPI rlRectangle rlGetGlyphAtlasRec(rlFont font, int codepoint);                                 // Get glyph rectangle in font atlas for a codepoint (unicode character), fallback to '?' if not found
@@ -70,6 +70,7 @@
 #include <string.h>         // Required for: strcmp(), strstr(), strcpy(), strncpy() [Used in rlTextReplace()], sscanf() [Used in LoadBMFont()]
 #include <stdarg.h>         // Required for: va_list, va_start(), vsprintf(), va_end() [Used in rlTextFormat()]
 #include <ctype.h>          // Required for: toupper(), tolower() [Used in rlTextToUpper(), rlTextToLower()]
+#include <stdint.h>         // Required for: uintptr_t [Used in GetGlyphLookupSlot()]
 
 #if defined(SUPPORT_FILEFORMAT_TTF) || defined(SUPPORT_FILEFORMAT_BDF)
     #if defined(__GNUC__) // GCC and Clang
@@ -115,11 +116,39 @@
 #ifndef MAX_TEXTSPLIT_COUNT
     #define MAX_TEXTSPLIT_COUNT                  128        // Maximum number of substrings to split: rlTextSplit()
 #endif
+#ifndef GLYPH_LOOKUP_DIRECT_SIZE
+    #define GLYPH_LOOKUP_DIRECT_SIZE             256        // Codepoints below this value are resolved by direct indexing (ASCII + Latin-1)
+#endif
 
 //----------------------------------------------------------------------------------
 // Types and Structures Definition
 //----------------------------------------------------------------------------------
-//...
+// Glyph quad ready to be written into the render batch
+typedef struct GlyphQuad {
+    float offsetX;              // Quad offset from pen position (unscaled, padding included)
+    float offsetY;
+    float width;                // Quad size (unscaled, padding included)
+    float height;
+    float u0, v0, u1, v1;       // Quad texture coordinates in font atlas
+    float advance;              // Pen advance (unscaled)
+} GlyphQuad;
+
+// Glyph lookup table, makes rlGetGlyphIndex() constant time
+// NOTE: Tables are keyed by the font glyphs array, built on font loading and freed with the glyphs
+typedef struct GlyphLookup {
+    const rlGlyphInfo *glyphs;              // Font glyphs the table was built for
+    int glyphCount;                         // Number of glyphs the table was built for
+    int fallbackIndex;                      // Index of fallback glyph '?'
+    int direct[GLYPH_LOOKUP_DIRECT_SIZE];   // Glyph index for codepoints below GLYPH_LOOKUP_DIRECT_SIZE (-1 if not in font)
+    int *hashCodepoints;                    // Open addressing hash map for the remaining codepoints (-1 on empty slots)
+    int *hashIndices;                       // Glyph index for every hash map slot
+    int hashSize;                           // Hash map slots count, power of two
+    GlyphQuad *quads;                       // Quad of every glyph, built on first draw
+    unsigned int quadsTextureId;            // Font atlas the quads were built for
+    int quadsTextureWidth;
+    int quadsTextureHeight;
+    int quadsPadding;                       // Font glyph padding the quads were built for
+} GlyphLookup;
 
 //----------------------------------------------------------------------------------
 // Global variables
@@ -130,6 +159,9 @@ extern bool isGpuReady;
 // NOTE: Default font is loaded on rlInitWindow() and disposed on rlCloseWindow() [module: core]
 static rlFont defaultFont = { 0 };
 #endif
+static GlyphLookup **glyphLookups = NULL;      // Glyph lookup tables of loaded fonts, open addressing hash map keyed by glyphs array
+static int glyphLookupsSize = 0;                // Hash map slots count, power of two
+static int glyphLookupsCount = 0;               // Glyph lookup tables in the hash map
 
 //----------------------------------------------------------------------------------
 // Other Modules Functions Declaration (required by text)
@@ -145,6 +177,14 @@ static rlFont LoadBMFont(const char *fileName);   // Load a BMFont file (AngelCo
 #if defined(SUPPORT_FILEFORMAT_BDF)
 static rlGlyphInfo *LoadFontDataBDF(const unsigned char *fileData, int dataSize, int *codepoints, int codepointCount, int *outFontSize);
 #endif
+static int GetGlyphLookupSlot(const rlGlyphInfo *glyphs);    // Get hash map slot of the lookup table for font glyphs, or the empty slot it would go in
+static GlyphLookup *LoadGlyphLookup(rlFont font);            // Build glyph lookup table for a font
+static GlyphLookup *GetGlyphLookup(rlFont font);             // Get glyph lookup table for a font, built if required
+static void UnloadGlyphLookup(const rlGlyphInfo *glyphs);    // Unload glyph lookup table built for font glyphs
+static int LookupGlyphIndex(const GlyphLookup *lookup, int codepoint);   // Get glyph index for a codepoint from lookup table
+static const GlyphQuad *GetGlyphQuads(GlyphLookup *lookup, rlFont font); // Get glyph quads for a font, built if required
+static int GetCodepointNextN(const char *text, int length, int *codepointSize);  // Get next codepoint, never reading more than length bytes
+static void DrawTextClipped(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, const rlRectangle *clip, rlColor tint); // Draw length bytes of text, skipping glyphs outside clip (if provided)
 static int textLineSpacing = 2;                 // Text vertical line spacing in pixels (between lines)
 
 #if defined(SUPPORT_DEFAULT_FONT)
@@ -302,6 +342,8 @@ extern void LoadFontDefault(void)
 
     defaultFont.baseSize = (int)defaultFont.recs[0].height;
 
+    LoadGlyphLookup(defaultFont);
+
     TRACELOG(LOG_INFO, "FONT: Default font loaded successfully (%i glyphs)", defaultFont.glyphCount);
 }
 
@@ -310,6 +352,7 @@ extern void UnloadFontDefault(void)
 {
     for (int i = 0; i < defaultFont.glyphCount; i++) rlUnloadImage(defaultFont.glyphs[i].image);
     if (isGpuReady) UnloadTexture(defaultFont.texture);
+    UnloadGlyphLookup(defaultFont.glyphs);
     RL_FREE(defaultFont.glyphs);
     RL_FREE(defaultFont.recs);
 }
@@ -520,6 +563,8 @@ rlFont rlLoadFontFromImage(rlImage image, rlColor key, int firstChar)
 
     font.baseSize = (int)font.recs[0].height;
 
+    LoadGlyphLookup(font);
+
     return font;
 }
 
@@ -571,6 +616,8 @@ rlFont rlLoadFontFromMemory(const char *fileType, const unsigned char *fileData,
 
         rlUnloadImage(atlas);
 
+        LoadGlyphLookup(font);
+
         TRACELOG(LOG_INFO, "FONT: Data loaded successfully (%i pixel size | %i glyphs)", font.baseSize, font.glyphCount);
     }
     else font = rlGetFontDefault();
@@ -941,6 +988,7 @@ void rlUnloadFontData(rlGlyphInfo *glyphs, int glyphCount)
     {
         for (int i = 0; i < glyphCount; i++) rlUnloadImage(glyphs[i].image);
 
+        UnloadGlyphLookup(glyphs);
         RL_FREE(glyphs);
     }
 }
@@ -1148,41 +1196,28 @@ void rlDrawText(const char *text, int posX, int posY, int fontSize, rlColor colo
 // NOTE: chars spacing is NOT proportional to fontSize
 void rlDrawTextEx(rlFont font, const char *text, rlVector2 position, float fontSize, float spacing, rlColor tint)
 {
-    if (font.texture.id == 0) font = rlGetFontDefault();  // Security check in case of not valid font
+    if (text == NULL) return;
 
-    int size = rlTextLength(text);    // Total size in bytes of the text, scanned by codepoints in loop
-
-    float textOffsetY = 0;          // Offset between lines (on linebreak '\n')
-    float textOffsetX = 0.0f;       // Offset X to next character to draw
-
-    float scaleFactor = fontSize/font.baseSize;         // Character quad scaling factor
+    DrawTextClipped(font, text, rlTextLength(text), position, fontSize, spacing, NULL, tint);
+}
 
-    for (int i = 0; i < size;)
-    {
-        // Get next codepoint from byte string and glyph index in font
-        int codepointByteCount = 0;
-        int codepoint = rlGetCodepointNext(&text[i], &codepointByteCount);
-        int index = rlGetGlyphIndex(font, codepoint);
+// Draw text using rlFont, only the first length bytes of text are drawn
+// NOTE: text does not need to be NULL terminated
+void rlDrawTextN(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, rlColor tint)
+{
+    if ((text == NULL) || (length <= 0)) return;
 
-        if (codepoint == '\n')
-        {
-            // NOTE: Line spacing is a global variable, use rlSetTextLineSpacing() to setup
-            textOffsetY += (fontSize + textLineSpacing);
-            textOffsetX = 0.0f;
-        }
-        else
-        {
-            if ((codepoint != ' ') && (codepoint != '\t'))
-            {
-                rlDrawTextCodepoint(font, codepoint, (rlVector2){ position.x + textOffsetX, position.y + textOffsetY }, fontSize, tint);
-            }
+    DrawTextClipped(font, text, length, position, fontSize, spacing, NULL, tint);
+}
 
-            if (font.glyphs[index].advanceX == 0) textOffsetX += ((float)font.recs[index].width*scaleFactor + spacing);
-            else textOffsetX += ((float)font.glyphs[index].advanceX*scaleFactor + spacing);
-        }
+// Draw text using rlFont, only the first length bytes of text are drawn
+// NOTE: Glyphs fully outside the clip rectangle are skipped, glyphs crossing its
+// border are drawn whole, use rlBeginScissorMode() for pixel exact clipping
+void rlDrawTextClipN(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, rlRectangle clip, rlColor tint)
+{
+    if ((text == NULL) || (length <= 0)) return;
 
-        i += codepointByteCount;   // Move text bytes counter to next codepoint
-    }
+    DrawTextClipped(font, text, length, position, fontSize, spacing, &clip, tint);
 }
 
 // Draw text using rlFont and pro parameters (rotation)
@@ -1280,12 +1315,21 @@ int rlMeasureText(const char *text, int fontSize)
 
 // Measure string size for rlFont
 rlVector2 rlMeasureTextEx(rlFont font, const char *text, float fontSize, float spacing)
+{
+    if (text == NULL) return (rlVector2){ 0 };
+
+    return rlMeasureTextN(font, text, rlTextLength(text), fontSize, spacing);
+}
+
+// Measure size of the first length bytes of text for rlFont
+// NOTE: text does not need to be NULL terminated
+rlVector2 rlMeasureTextN(rlFont font, const char *text, int length, float fontSize, float spacing)
 {
     rlVector2 textSize = { 0 };
 
-    if ((isGpuReady && (font.texture.id == 0)) || (text == NULL)) return textSize; // Security check
+    if ((isGpuReady && (font.texture.id == 0)) || (text == NULL) || (length <= 0)) return textSize; // Security check
 
-    int size = rlTextLength(text);    // Get size in bytes of text
+    int size = length;              // Size in bytes of text
     int tempByteCounter = 0;        // Used to count longer text line num chars
     int byteCounter = 0;
 
@@ -1303,7 +1347,7 @@ rlVector2 rlMeasureTextEx(rlFont font, const char *text, float fontSize, float s
         byteCounter++;
 
         int next = 0;
-        letter = rlGetCodepointNext(&text[i], &next);
+        letter = GetCodepointNextN(&text[i], size - i, &next);
         index = rlGetGlyphIndex(font, letter);
 
         i += next;
@@ -1342,21 +1386,10 @@ int rlGetGlyphIndex(rlFont font, int codepoint)
 
 #define SUPPORT_UNORDERED_CHARSET
 #if defined(SUPPORT_UNORDERED_CHARSET)
-    int fallbackIndex = 0;      // Get index of fallback glyph '?'
-
-    // Look for character index in the unordered charset
-    for (int i = 0; i < font.glyphCount; i++)
-    {
-        if (font.glyphs[i].value == 63) fallbackIndex = i;
+    if (font.glyphs == NULL) return index;
 
-        if (font.glyphs[i].value == codepoint)
-        {
-            index = i;
-            break;
-        }
-    }
-
-    if ((index == 0) && (font.glyphs[0].value != codepoint)) index = fallbackIndex;
+    // Look for character index in the font lookup table, fallback to '?' if not found
+    index = LookupGlyphIndex(GetGlyphLookup(font), codepoint);
 #else
     index = codepoint - 32;
 #endif
@@ -2134,6 +2167,303 @@ int rlGetCodepointPrevious(const char *text, int *codepointSize)
 //----------------------------------------------------------------------------------
 // Module specific Functions Definition
 //----------------------------------------------------------------------------------
+// Build glyph lookup table for a font and register it
+// NOTE: For every codepoint the first glyph with that value is used, like a linear search would do
+static GlyphLookup *LoadGlyphLookup(rlFont font)
+{
+    if (font.glyphs == NULL) return NULL;
+
+    UnloadGlyphLookup(font.glyphs);     // Make sure no outdated table is left for this glyphs
+
+    GlyphLookup *lookup = (GlyphLookup *)RL_CALLOC(1, sizeof(GlyphLookup));
+    lookup->glyphs = font.glyphs;
+    lookup->glyphCount = font.glyphCount;
+
+    for (int i = 0; i < GLYPH_LOOKUP_DIRECT_SIZE; i++) lookup->direct[i] = -1;
+
+    int hashedCount = 0;
+    for (int i = 0; i < font.glyphCount; i++)
+    {
+        if (font.glyphs[i].value == 63) lookup->fallbackIndex = i;
+        if ((font.glyphs[i].value < 0) || (font.glyphs[i].value >= GLYPH_LOOKUP_DIRECT_SIZE)) hashedCount++;
+    }
+
+    if (hashedCount > 0)
+    {
+        // Keep the hash map at most half full
+        lookup->hashSize = 1;
+        while (lookup->hashSize < hashedCount*2) lookup->hashSize *= 2;
+
+        lookup->hashCodepoints = (int *)RL_MALLOC(lookup->hashSize*sizeof(int));
+        lookup->hashIndices = (int *)RL_MALLOC(lookup->hashSize*sizeof(int));
+        for (int i = 0; i < lookup->hashSize; i++) lookup->hashCodepoints[i] = -1;
+    }
+
+    for (int i = 0; i < font.glyphCount; i++)
+    {
+        int codepoint = font.glyphs[i].value;
+
+        if ((codepoint >= 0) && (codepoint < GLYPH_LOOKUP_DIRECT_SIZE))
+        {
+            if (lookup->direct[codepoint] == -1) lookup->direct[codepoint] = i;
+        }
+        else if (codepoint >= 0)
+        {
+            int mask = lookup->hashSize - 1;
+            int slot = (int)(((unsigned int)codepoint*2654435761u) & mask);
+            while ((lookup->hashCodepoints[slot] != -1) && (lookup->hashCodepoints[slot] != codepoint)) slot = (slot + 1) & mask;
+
+            if (lookup->hashCodepoints[slot] == -1)
+            {
+                lookup->hashCodepoints[slot] = codepoint;
+                lookup->hashIndices[slot] = i;
+            }
+        }
+    }
+
+    // Keep the hash map of tables at most half full
+    if ((glyphLookupsCount + 1)*2 > glyphLookupsSize)
+    {
+        GlyphLookup **oldLookups = glyphLookups;
+        int oldSize = glyphLookupsSize;
+
+        glyphLookupsSize = (oldSize == 0)? 8 : oldSize*2;
+        glyphLookups = (GlyphLookup **)RL_CALLOC(glyphLookupsSize, sizeof(GlyphLookup *));
+        for (int i = 0; i < oldSize; i++)
+        {
+            if (oldLookups[i] != NULL) glyphLookups[GetGlyphLookupSlot(oldLookups[i]->glyphs)] = oldLookups[i];
+        }
+
+        RL_FREE(oldLookups);
+    }
+
+    glyphLookups[GetGlyphLookupSlot(font.glyphs)] = lookup;
+    glyphLookupsCount++;
+
+    return lookup;
+}
+
+// Get hash map slot of the lookup table for font glyphs, or the empty slot it would go in
+// NOTE: Requires glyphLookupsSize > 0
+static int GetGlyphLookupSlot(const rlGlyphInfo *glyphs)
+{
+    int mask = glyphLookupsSize - 1;
+    int slot = (int)((unsigned int)(((uintptr_t)glyphs >> 4)*2654435761u) & mask);
+
+    while ((glyphLookups[slot] != NULL) && (glyphLookups[slot]->glyphs != glyphs)) slot = (slot + 1) & mask;
+
+    return slot;
+}
+
+// Get glyph lookup table for a font
+// NOTE: Fonts not loaded by raylib (i.e. exported as code) get their table built on first use
+static GlyphLookup *GetGlyphLookup(rlFont font)
+{
+    if (glyphLookupsSize > 0)
+    {
+        GlyphLookup *lookup = glyphLookups[GetGlyphLookupSlot(font.glyphs)];
+        if ((lookup != NULL) && (lookup->glyphCount == font.glyphCount)) return lookup;
+    }
+
+    return LoadGlyphLookup(font);
+}
+
+// Unload glyph lookup table built for font glyphs
+static void UnloadGlyphLookup(const rlGlyphInfo *glyphs)
+{
+    if (glyphLookupsSize == 0) return;
+
+    int mask = glyphLookupsSize - 1;
+    int slot = GetGlyphLookupSlot(glyphs);
+    GlyphLookup *lookup = glyphLookups[slot];
+    if (lookup == NULL) return;
+
+    RL_FREE(lookup->hashCodepoints);
+    RL_FREE(lookup->hashIndices);
+    RL_FREE(lookup->quads);
+    RL_FREE(lookup);
+    glyphLookups[slot] = NULL;
+    glyphLookupsCount--;
+
+    // Move back the tables after it that would not be found past the emptied slot anymore
+    for (int next = (slot + 1) & mask; glyphLookups[next] != NULL; next = (next + 1) & mask)
+    {
+        GlyphLookup *moved = glyphLookups[next];
+        glyphLookups[next] = NULL;
+        glyphLookups[GetGlyphLookupSlot(moved->glyphs)] = moved;
+    }
+
+    if (glyphLookupsCount == 0)
+    {
+        RL_FREE(glyphLookups);
+        glyphLookups = NULL;
+        glyphLookupsSize = 0;
+    }
+}
+
+// Get glyph index for a codepoint from lookup table, fallback to '?' if not found
+static int LookupGlyphIndex(const GlyphLookup *lookup, int codepoint)
+{
+    int index = lookup->fallbackIndex;
+
+    if ((codepoint >= 0) && (codepoint < GLYPH_LOOKUP_DIRECT_SIZE))
+    {
+        if (lookup->direct[codepoint] != -1) index = lookup->direct[codepoint];
+    }
+    else if (lookup->hashSize > 0)
+    {
+        int mask = lookup->hashSize - 1;
+        for (int slot = (int)(((unsigned int)codepoint*2654435761u) & mask); lookup->hashCodepoints[slot] != -1; slot = (slot + 1) & mask)
+        {
+            if (lookup->hashCodepoints[slot] == codepoint)
+            {
+                index = lookup->hashIndices[slot];
+                break;
+            }
+        }
+    }
+
+    return index;
+}
+
+// Get glyph quads for a font, built if required
+// NOTE: Quads are rebuilt if the font atlas or padding changed since they were built
+static const GlyphQuad *GetGlyphQuads(GlyphLookup *lookup, rlFont font)
+{
+    if ((lookup->quads != NULL) && (lookup->quadsTextureId == font.texture.id) &&
+        (lookup->quadsTextureWidth == font.texture.width) && (lookup->quadsTextureHeight == font.texture.height) &&
+        (lookup->quadsPadding == font.glyphPadding)) return lookup->quads;
+
+    if (lookup->quads == NULL) lookup->quads = (GlyphQuad *)RL_MALLOC(lookup->glyphCount*sizeof(GlyphQuad));
+
+    float width = (font.texture.width > 0)? (float)font.texture.width : 1.0f;
+    float height = (font.texture.height > 0)? (float)font.texture.height : 1.0f;
+    float padding = (float)font.glyphPadding;
+
+    for (int i = 0; i < lookup->glyphCount; i++)
+    {
+        rlRectangle rec = font.recs[i];
+        GlyphQuad *quad = &lookup->quads[i];
+
+        // NOTE: We consider glyphPadding on drawing, same as rlDrawTextCodepoint()
+        quad->offsetX = font.glyphs[i].offsetX - padding;
+        quad->offsetY = font.glyphs[i].offsetY - padding;
+        quad->width = rec.width + 2.0f*padding;
+        quad->height = rec.height + 2.0f*padding;
+        quad->u0 = (rec.x - padding)/width;
+        quad->v0 = (rec.y - padding)/height;
+        quad->u1 = (rec.x + rec.width + padding)/width;
+        quad->v1 = (rec.y + rec.height + padding)/height;
+        quad->advance = (font.glyphs[i].advanceX == 0)? rec.width : (float)font.glyphs[i].advanceX;
+    }
+
+    lookup->quadsTextureId = font.texture.id;
+    lookup->quadsTextureWidth = font.texture.width;
+    lookup->quadsTextureHeight = font.texture.height;
+    lookup->quadsPadding = font.glyphPadding;
+
+    return lookup->quads;
+}
+
+// Get next codepoint in a UTF-8 encoded string, never reading more than length bytes
+// NOTE: A sequence cut by the end of the text is returned as '?' (1 byte)
+static int GetCodepointNextN(const char *text, int length, int *codepointSize)
+{
+    if (length >= 4) return rlGetCodepointNext(text, codepointSize);
+
+    // Near the end, decode from a zero padded copy, the padding fails the 10xxxxxx checks
+    char tail[4] = { 0 };
+    for (int i = 0; i < length; i++) tail[i] = text[i];
+
+    return rlGetCodepointNext(tail, codepointSize);
+}
+
+// Draw length bytes of text, skipping glyphs outside clip (if provided)
+// NOTE: Glyph quads are written straight into the render batch, texture and
+// color are set once for the whole text instead of once per glyph
+static void DrawTextClipped(rlFont font, const char *text, int length, rlVector2 position, float fontSize, float spacing, const rlRectangle *clip, rlColor tint)
+{
+    if (font.texture.id == 0) font = rlGetFontDefault();  // Security check in case of not valid font
+    if (font.glyphs == NULL) return;
+
+    GlyphLookup *lookup = GetGlyphLookup(font);
+    const GlyphQuad *quads = GetGlyphQuads(lookup, font);
+
+    float textOffsetY = 0;          // Offset between lines (on linebreak '\n')
+    float textOffsetX = 0.0f;       // Offset X to next character to draw
+
+    float scaleFactor = fontSize/font.baseSize;         // Character quad scaling factor
+
+    rlSetTexture(font.texture.id);
+    rlBegin(RL_QUADS);
+
+        rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+        rlNormal3f(0.0f, 0.0f, 1.0f);                  // Normal vector pointing towards viewer
+
+        for (int i = 0; i < length;)
+        {
+            if (clip != NULL)
+            {
+                float lineY = position.y + textOffsetY;
+
+                if (lineY > (clip->y + clip->height)) break;    // Below the clip, nothing else can be visible
+
+                if (((lineY + fontSize) < clip->y) || ((position.x + textOffsetX) > (clip->x + clip->width)))
+                {
+                    // Rest of the line is not visible, jump to the next linebreak
+                    while ((i < length) && (text[i] != '\n')) i++;
+                    if (i == length) break;
+                }
+            }
+
+            // Get next codepoint from byte string and glyph quad in font
+            int codepointByteCount = 0;
+            int codepoint = GetCodepointNextN(&text[i], length - i, &codepointByteCount);
+
+            if (codepoint == '\n')
+            {
+                // NOTE: Line spacing is a global variable, use rlSetTextLineSpacing() to setup
+                textOffsetY += (fontSize + textLineSpacing);
+                textOffsetX = 0.0f;
+            }
+            else
+            {
+                const GlyphQuad *quad = &quads[LookupGlyphIndex(lookup, codepoint)];
+                float advance = quad->advance*scaleFactor;
+
+                bool visible = (codepoint != ' ') && (codepoint != '\t');
+                if (visible && (clip != NULL)) visible = ((position.x + textOffsetX + advance) >= clip->x);
+
+                if (visible)
+                {
+                    float x = position.x + textOffsetX + quad->offsetX*scaleFactor;
+                    float y = position.y + textOffsetY + quad->offsetY*scaleFactor;
+                    float w = quad->width*scaleFactor;
+                    float h = quad->height*scaleFactor;
+
+                    // Flush the batch when full, texture and mode are kept for the next vertices
+                    rlCheckRenderBatchLimit(4);
+
+                    rlTexCoord2f(quad->u0, quad->v0);
+                    rlVertex2f(x, y);
+                    rlTexCoord2f(quad->u0, quad->v1);
+                    rlVertex2f(x, y + h);
+                    rlTexCoord2f(quad->u1, quad->v1);
+                    rlVertex2f(x + w, y + h);
+                    rlTexCoord2f(quad->u1, quad->v0);
+                    rlVertex2f(x + w, y);
+                }
+
+                textOffsetX += (advance + spacing);
+            }
+
+            i += codepointByteCount;   // Move text bytes counter to next codepoint
+        }
+
+    rlEnd();
+    rlSetTexture(0);
+}
+
 #if defined(SUPPORT_FILEFORMAT_FNT) || defined(SUPPORT_FILEFORMAT_BDF)
 // Read a line from memory
 // REQUIRES: memcpy()
@@ -2305,6 +2635,8 @@ static rlFont LoadBMFont(const char *fileName)
     rlUnloadImage(fullFont);
     rlUnloadFileText(fileText);
 
+    LoadGlyphLookup(font);
+
     if (isGpuReady && (font.texture.id == 0))
     {
         rlUnloadFont(font);
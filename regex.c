@@ -0,0 +1,862 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regex.h"
+#include "dynamic_array.h"
+#include "scan.h"
+#include "arena.h"
+
+#define REGEX_TABLE_SIZE (4*REGEX_MAX_STATES) // power of two
+#define REGEX_MAX_REPEAT 1000
+
+#define STATE_BOL       1  // the byte before is a '\n', or the text starts here
+#define STATE_SEEN      2  // a match was seen, no new ones get started
+#define STATE_MATCH     4  // a match ends here
+#define STATE_MATCH_EOL 8  // a match ends here if a '\n' or the end of the text follows
+#define STATE_DEAD      16 // no match ends anywhere further
+#define STATE_CHECK     32 // not known yet if it can be skipped through
+#define STATE_SKIP      64 // all its transitions are known, most lead back to it
+#define STATE_SLOW      (STATE_MATCH | STATE_MATCH_EOL | STATE_DEAD | STATE_CHECK | STATE_SKIP)
+
+// ---------------------------------------------------------------------------
+// Parser, builds a syntax tree that is then compiled both ways
+
+typedef enum {
+    NODE_EMPTY,
+    NODE_CLASS,
+    NODE_CAT,
+    NODE_ALT,
+    NODE_REPEAT, // max -1 for no limit
+    NODE_BOL,
+    NODE_EOL,
+} NodeType;
+
+typedef struct {
+    NodeType type;
+    int a;
+    int b;
+    int min;
+    int max;
+} RegexNode;
+
+typedef struct {
+    RegexNode *items;
+    size_t size;
+    size_t count;
+} RegexNodes;
+
+typedef struct {
+    Regex      *re;
+    const char *pattern;
+    size_t      n;
+    size_t      i;
+    RegexNodes  nodes;
+} RegexParser;
+
+static void class_add(RegexClass *c, unsigned char lo, unsigned char hi)
+{
+    for (int b=lo; b<=hi; b++)
+        c->bits[b >> 5] |= 1u << (b & 31);
+}
+
+static void class_negate(RegexClass *c)
+{
+    for (int i=0; i<8; i++) c->bits[i] = ~c->bits[i];
+}
+
+static bool class_has(const RegexClass *c, unsigned char b)
+{
+    return (c->bits[b >> 5] >> (b & 31)) & 1;
+}
+
+static int regex_node(RegexParser *p, NodeType type, int a, int b)
+{
+    da_append(&p->nodes, ((RegexNode){ type, a, b, 0, 0 }));
+    return p->nodes.count - 1;
+}
+
+static int regex_class_node(RegexParser *p, RegexClass c)
+{
+    da_append(&p->re->classes, c);
+    return regex_node(p, NODE_CLASS, p->re->classes.count - 1, 0);
+}
+
+static int regex_fail(RegexParser *p, const char *error)
+{
+    snprintf(p->re->error, sizeof(p->re->error), "%s", error);
+    return -1;
+}
+
+// adds what the escape after the '\' at p->i stands for, returns the byte
+// for a single byte escape and -1 for a class
+static int regex_escape(RegexParser *p, RegexClass *c)
+{
+    const char e = p->pattern[p->i++];
+    RegexClass set = {0};
+    switch (e)
+    {
+    case 'd': case 'D':
+        class_add(&set, '0', '9');
+        break;
+    case 'w': case 'W':
+        class_add(&set, 'a', 'z');
+        class_add(&set, 'A', 'Z');
+        class_add(&set, '0', '9');
+        class_add(&set, '_', '_');
+        break;
+    case 's': case 'S':
+        class_add(&set, ' ', ' ');
+        class_add(&set, '\t', '\r'); // \t \n \v \f \r
+        break;
+    case 'n': class_add(c, '\n', '\n'); return '\n';
+    case 't': class_add(c, '\t', '\t'); return '\t';
+    case 'r': class_add(c, '\r', '\r'); return '\r';
+    default:  class_add(c, e, e); return (unsigned char)e;
+    }
+    if (e == 'D' || e == 'W' || e == 'S') class_negate(&set);
+    for (int i=0; i<8; i++) c->bits[i] |= set.bits[i];
+    return -1;
+}
+
+// [abc], [a-z], [^...], the '[' is already taken
+static int regex_parse_class(RegexParser *p)
+{
+    RegexClass c = {0};
+    const bool negate = p->i < p->n && p->pattern[p->i] == '^';
+    if (negate) p->i++;
+
+    for (bool first = true; ; first = false)
+    {
+        if (p->i >= p->n) return regex_fail(p, "missing ]");
+        const char ch = p->pattern[p->i];
+        if (ch == ']' && !first) break;
+
+        int lo;
+        p->i++;
+        if (ch == '\\')
+        {
+            if (p->i >= p->n) return regex_fail(p, "trailing \\");
+            lo = regex_escape(p, &c);
+            if (lo < 0) continue;
+        }
+        else
+        {
+            lo = (unsigned char)ch;
+            class_add(&c, lo, lo);
+        }
+
+        // a range, unless the '-' is the last thing in the class
+        if (p->i + 1 < p->n && p->pattern[p->i] == '-' && p->pattern[p->i + 1] != ']')
+        {
+            int hi = (unsigned char)p->pattern[p->i + 1];
+            p->i += 2;
+            if (hi == '\\')
+            {
+                if (p->i >= p->n) return regex_fail(p, "trailing \\");
+                RegexClass ignored = {0};
+                hi = regex_escape(p, &ignored);
+                if (hi < 0) return regex_fail(p, "bad range");
+            }
+            if (hi < lo) return regex_fail(p, "bad range");
+            class_add(&c, lo, hi);
+        }
+    }
+    p->i++;
+    if (negate) class_negate(&c);
+    return regex_class_node(p, c);
+}
+
+static int regex_parse_alt(RegexParser *p);
+
+static int regex_parse_atom(RegexParser *p)
+{
+    const char ch = p->pattern[p->i++];
+    RegexClass c = {0};
+    switch (ch)
+    {
+    case '(':
+    {
+        const int node = regex_parse_alt(p);
+        if (node < 0) return -1;
+        if (p->i >= p->n || p->pattern[p->i] != ')') return regex_fail(p, "missing )");
+        p->i++;
+        return node;
+    }
+    case '[':
+        return regex_parse_class(p);
+    case '.':
+        class_add(&c, 0, 255);
+        c.bits['\n' >> 5] &= ~(1u << ('\n' & 31));
+        return regex_class_node(p, c);
+    case '^':
+        return regex_node(p, NODE_BOL, 0, 0);
+    case '$':
+        return regex_node(p, NODE_EOL, 0, 0);
+    case '*': case '+': case '?':
+        return regex_fail(p, "nothing to repeat");
+    case '\\':
+        if (p->i >= p->n) return regex_fail(p, "trailing \\");
+        regex_escape(p, &c);
+        return regex_class_node(p, c);
+    default:
+        class_add(&c, ch, ch);
+        return regex_class_node(p, c);
+    }
+}
+
+static bool regex_parse_number(RegexParser *p, int *n)
+{
+    if (p->i >= p->n || p->pattern[p->i] < '0' || p->pattern[p->i] > '9') return false;
+    *n = 0;
+    for (; p->i < p->n && p->pattern[p->i] >= '0' && p->pattern[p->i] <= '9'; p->i++)
+        if (*n <= REGEX_MAX_REPEAT) *n = *n*10 + p->pattern[p->i] - '0';
+    return true;
+}
+
+// {m}, {m,} or {m,n} at p->i, false (and nothing taken) if it is not one
+static bool regex_parse_count(RegexParser *p, int *min, int *max)
+{
+    const size_t start = p->i++;
+    bool ok = regex_parse_number(p, min);
+    if (ok)
+    {
+        *max = *min;
+        if (p->i < p->n && p->pattern[p->i] == ',')
+        {
+            p->i++;
+            if (!regex_parse_number(p, max)) *max = -1;
+        }
+        ok = p->i < p->n && p->pattern[p->i] == '}';
+    }
+    if (!ok)
+    {   // just a '{'
+        p->i = start;
+        return false;
+    }
+    p->i++;
+    return true;
+}
+
+static int regex_parse_repeat(RegexParser *p)
+{
+    int node = regex_parse_atom(p);
+    while (node >= 0 && p->i < p->n)
+    {
+        const char ch = p->pattern[p->i];
+        int min, max;
+        if (ch == '*')      { min = 0; max = -1; p->i++; }
+        else if (ch == '+') { min = 1; max = -1; p->i++; }
+        else if (ch == '?') { min = 0; max = 1; p->i++; }
+        else if (ch != '{' || !regex_parse_count(p, &min, &max)) break;
+
+        if (min > REGEX_MAX_REPEAT || max > REGEX_MAX_REPEAT) return regex_fail(p, "repetition too big");
+        if (max >= 0 && max < min) return regex_fail(p, "bad repetition");
+        node = regex_node(p, NODE_REPEAT, node, 0);
+        p->nodes.items[node].min = min;
+        p->nodes.items[node].max = max;
+    }
+    return node;
+}
+
+static int regex_parse_cat(RegexParser *p)
+{
+    int node = -1;
+    while (p->i < p->n && p->pattern[p->i] != '|' && p->pattern[p->i] != ')')
+    {
+        const int next = regex_parse_repeat(p);
+        if (next < 0) return -1;
+        node = node < 0 ? next : regex_node(p, NODE_CAT, node, next);
+    }
+    return node < 0 ? regex_node(p, NODE_EMPTY, 0, 0) : node;
+}
+
+static int regex_parse_alt(RegexParser *p)
+{
+    int node = regex_parse_cat(p);
+    while (node >= 0 && p->i < p->n && p->pattern[p->i] == '|')
+    {
+        p->i++;
+        const int next = regex_parse_cat(p);
+        if (next < 0) return -1;
+        node = regex_node(p, NODE_ALT, node, next);
+    }
+    return node;
+}
+
+// ---------------------------------------------------------------------------
+// Compiler, the reversed program matches the reversed text
+
+static int regex_inst(RegexProg *prog, RegexOp op, int x, int y)
+{
+    da_append(prog, ((RegexInst){ op, x, y }));
+    return prog->count - 1;
+}
+
+static bool regex_emit(RegexProg *prog, const RegexNodes *nodes, int index, bool reversed)
+{
+    if (prog->count > REGEX_MAX_INSTS) return false;
+    const RegexNode node = nodes->items[index];
+    switch (node.type)
+    {
+    case NODE_EMPTY:
+        return true;
+    case NODE_CLASS:
+        regex_inst(prog, REGEX_CLASS, node.a, 0);
+        return true;
+    case NODE_BOL:
+        regex_inst(prog, reversed ? REGEX_EOL : REGEX_BOL, 0, 0);
+        return true;
+    case NODE_EOL:
+        regex_inst(prog, reversed ? REGEX_BOL : REGEX_EOL, 0, 0);
+        return true;
+    case NODE_CAT:
+        return regex_emit(prog, nodes, reversed ? node.b : node.a, reversed) &&
+               regex_emit(prog, nodes, reversed ? node.a : node.b, reversed);
+    case NODE_ALT:
+    {
+        const int split = regex_inst(prog, REGEX_SPLIT, prog->count + 1, 0);
+        if (!regex_emit(prog, nodes, node.a, reversed)) return false;
+        const int jump = regex_inst(prog, REGEX_JUMP, 0, 0);
+        prog->items[split].y = prog->count;
+        if (!regex_emit(prog, nodes, node.b, reversed)) return false;
+        prog->items[jump].x = prog->count;
+        return true;
+    }
+    case NODE_REPEAT:
+        for (int i=0; i<node.min; i++)
+            if (!regex_emit(prog, nodes, node.a, reversed)) return false;
+        if (node.max < 0)
+        {   // loops back before the split
+            const int split = regex_inst(prog, REGEX_SPLIT, prog->count + 1, 0);
+            if (!regex_emit(prog, nodes, node.a, reversed)) return false;
+            regex_inst(prog, REGEX_JUMP, split, 0);
+            prog->items[split].y = prog->count;
+            return true;
+        }
+        for (int i=node.min; i<node.max; i++)
+        {   // optional copies
+            const int split = regex_inst(prog, REGEX_SPLIT, prog->count + 1, 0);
+            if (!regex_emit(prog, nodes, node.a, reversed)) return false;
+            prog->items[split].y = prog->count;
+        }
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// Lazy DFA
+
+static void regex_dfa_init(RegexDfa *d)
+{
+    *d = (RegexDfa) {0};
+    da_init(&d->prog);
+    da_init(&d->states);
+    da_init(&d->threads);
+    da_init(&d->table);
+    da_init(&d->stamps);
+    da_init(&d->stack);
+    da_init(&d->work);
+    da_init(&d->expanded);
+    da_init(&d->out);
+}
+
+static void regex_dfa_free(RegexDfa *d)
+{
+    da_free(&d->prog);
+    da_free(&d->states);
+    da_free(&d->threads);
+    da_free(&d->table);
+    da_free(&d->stamps);
+    da_free(&d->stack);
+    da_free(&d->work);
+    da_free(&d->expanded);
+    da_free(&d->out);
+}
+
+// forgets every state
+static void regex_dfa_flush(RegexDfa *d)
+{
+    d->states.count = 0;
+    d->threads.count = 0;
+    memset(d->table.items, 0, d->table.count*sizeof(int));
+    d->starts[0] = d->starts[1] = -1;
+    d->flushes++;
+}
+
+// gets the DFA ready for a freshly compiled program
+static void regex_dfa_reset(RegexDfa *d)
+{
+    da_reserve(&d->table, REGEX_TABLE_SIZE);
+    d->table.count = REGEX_TABLE_SIZE;
+    da_reserve(&d->stamps, d->prog.count);
+    d->stamps.count = d->prog.count;
+    memset(d->stamps.items, 0, d->stamps.count*sizeof(int));
+    d->generation = 0;
+    d->lines = false;
+    for (size_t i=0; i<d->prog.count; i++)
+        if (d->prog.items[i].op == REGEX_BOL || d->prog.items[i].op == REGEX_EOL) d->lines = true;
+    regex_dfa_flush(d);
+}
+
+// NFA states added after this are told apart from the ones added before
+static void regex_generation(RegexDfa *d)
+{
+    if (d->generation == __INT_MAX__)
+    {
+        memset(d->stamps.items, 0, d->stamps.count*sizeof(int));
+        d->generation = 0;
+    }
+    d->generation++;
+}
+
+// adds the NFA states reachable from `pc` without consuming a byte, at the
+// start of a line if `bol` and at its end if `eol`
+static void regex_closure(RegexDfa *d, RegexInts *out, int pc, bool bol, bool eol)
+{
+    d->stack.count = 0;
+    da_append(&d->stack, pc);
+    while (d->stack.count > 0)
+    {
+        pc = d->stack.items[--d->stack.count];
+        if (d->stamps.items[pc] == d->generation) continue;
+        d->stamps.items[pc] = d->generation;
+
+        const RegexInst inst = d->prog.items[pc];
+        switch (inst.op)
+        {
+        case REGEX_JUMP:
+            da_append(&d->stack, inst.x);
+            break;
+        case REGEX_SPLIT:
+            da_append(&d->stack, inst.y);
+            da_append(&d->stack, inst.x);
+            break;
+        case REGEX_BOL:
+            if (bol) da_append(&d->stack, pc + 1);
+            break;
+        case REGEX_EOL:
+            if (eol) da_append(&d->stack, pc + 1);
+            else da_append(out, pc);
+            break;
+        default: // waits for a byte, a line end or is a match
+            da_append(out, pc);
+            break;
+        }
+    }
+}
+
+static uint64_t regex_hash(const int *items, size_t n, uint8_t flags)
+{
+    uint64_t h = 14695981039346656037ull ^ flags;
+    for (size_t i=0; i<n; i++)
+        h = (h ^ (uint32_t)items[i]) * 1099511628211ull;
+    return h;
+}
+
+// the state made of `list` (NFA states, groups split by -1), added if new
+static int regex_intern(RegexDfa *d, const RegexInts *list, uint8_t flags)
+{
+    flags &= STATE_BOL | STATE_SEEN;
+    if (list->count == 0 || !d->lines) flags &= STATE_SEEN;
+
+    const size_t mask = REGEX_TABLE_SIZE - 1;
+    size_t slot = regex_hash(list->items, list->count, flags) & mask;
+    for (; d->table.items[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const RegexState *s = &d->states.items[d->table.items[slot] - 1];
+        if ((s->flags & (STATE_BOL | STATE_SEEN)) == flags && s->count == list->count &&
+            (list->count == 0 || memcmp(d->threads.items + s->threads, list->items, list->count*sizeof(int)) == 0))
+            return d->table.items[slot] - 1;
+    }
+
+    if (d->states.count == REGEX_MAX_STATES)
+    {   // the list is scratch, it survives the flush
+        regex_dfa_flush(d);
+        slot = regex_hash(list->items, list->count, flags) & mask;
+    }
+
+    RegexState s = { .threads = d->threads.count, .count = list->count, .flags = flags };
+    memset(s.next, 0xff, sizeof(s.next));
+    // with nothing left a match can still start on the next byte, unless one
+    // was seen already
+    if (list->count == 0 && (d->anchored || (flags & STATE_SEEN))) s.flags |= STATE_DEAD;
+    for (size_t i=0; i<list->count; i++)
+    {
+        const int pc = list->items[i];
+        if (pc >= 0 && d->prog.items[pc].op == REGEX_MATCH) s.flags |= STATE_MATCH;
+    }
+
+    // would a line end here finish a match
+    d->expanded.count = 0;
+    regex_generation(d);
+    for (size_t i=0; i<list->count; i++)
+    {
+        const int pc = list->items[i];
+        if (pc >= 0 && d->prog.items[pc].op == REGEX_EOL)
+            regex_closure(d, &d->expanded, pc + 1, flags & STATE_BOL, true);
+    }
+    for (size_t i=0; i<d->expanded.count; i++)
+        if (d->prog.items[d->expanded.items[i]].op == REGEX_MATCH) s.flags |= STATE_MATCH_EOL;
+
+    if (d->threads.size < d->threads.count + list->count)
+        da_reserve(&d->threads, (d->threads.count + list->count)*2);
+    if (list->count > 0) memcpy(d->threads.items + d->threads.count, list->items, list->count*sizeof(int));
+    d->threads.count += list->count;
+
+    da_append(&d->states, s);
+    while (d->table.items[slot] != 0) slot = (slot + 1) & mask;
+    d->table.items[slot] = d->states.count;
+    return d->states.count - 1;
+}
+
+// both start states are made together, so that the search gets back to the
+// one not after a '\n' on its own too and it is checked for skipping
+static int regex_start(RegexDfa *d, bool bol)
+{
+    while (d->starts[bol] < 0)
+    {   // a flush making the second one forgets the first
+        for (int b=0; b<2; b++)
+        {
+            if (d->starts[b] >= 0) continue;
+            regex_generation(d);
+            d->out.count = 0;
+            regex_closure(d, &d->out, 0, b, false);
+            const size_t count = d->states.count;
+            const int si = regex_intern(d, &d->out, b ? STATE_BOL : 0);
+            if (!d->anchored && d->states.count > count) d->states.items[si].flags |= STATE_CHECK;
+            d->starts[b] = si;
+        }
+    }
+    return d->starts[bol];
+}
+
+// works out the state after `si` reads the byte `c`
+static int regex_step(Regex *re, RegexDfa *d, int si, unsigned char c)
+{
+    const size_t flushes = d->flushes;
+    const uint8_t flags = d->states.items[si].flags;
+
+    // the state may move while new ones get added
+    const RegexState *s = &d->states.items[si];
+    d->work.count = 0;
+    da_reserve(&d->work, s->count);
+    memcpy(d->work.items, d->threads.items + s->threads, s->count*sizeof(int));
+    d->work.count = s->count;
+
+    // a '\n' lets the states waiting for the end of the line go on
+    regex_generation(d);
+    d->expanded.count = 0;
+    for (size_t i=0; i<d->work.count; i++)
+    {
+        const int pc = d->work.items[i];
+        if (pc < 0)
+            da_append(&d->expanded, -1);
+        else if (d->prog.items[pc].op == REGEX_EOL)
+        {
+            if (c == '\n') regex_closure(d, &d->expanded, pc + 1, flags & STATE_BOL, true);
+        }
+        else if (d->stamps.items[pc] != d->generation)
+        {
+            d->stamps.items[pc] = d->generation;
+            da_append(&d->expanded, pc);
+        }
+    }
+
+    // the groups after the first one with a match started later, they lose
+    bool match = false;
+    for (size_t i=0; i<d->expanded.count; i++)
+    {
+        const int pc = d->expanded.items[i];
+        if (pc >= 0 && d->prog.items[pc].op == REGEX_MATCH) match = true;
+        if (pc < 0 && match)
+        {
+            d->expanded.count = i;
+            break;
+        }
+    }
+
+    // read the byte
+    const bool bol = c == '\n';
+    regex_generation(d);
+    d->out.count = 0;
+    size_t group = 0; // where the current group starts in out
+    for (size_t i=0; i<d->expanded.count; i++)
+    {
+        const int pc = d->expanded.items[i];
+        if (pc < 0)
+        {
+            if (d->out.count > group)
+            {
+                da_append(&d->out, -1);
+                group = d->out.count;
+            }
+            continue;
+        }
+        const RegexInst inst = d->prog.items[pc];
+        if (inst.op == REGEX_CLASS && class_has(&re->classes.items[inst.x], c))
+            regex_closure(d, &d->out, pc + 1, bol, false);
+    }
+
+    // a match may also start after the byte, as long as none was seen
+    const uint8_t next = (bol ? STATE_BOL : 0) | ((flags & STATE_SEEN) || match ? STATE_SEEN : 0);
+    if (!d->anchored && !(next & STATE_SEEN))
+    {
+        if (d->out.count > group) da_append(&d->out, -1);
+        regex_closure(d, &d->out, 0, bol, false);
+    }
+    if (d->out.count > 0 && d->out.items[d->out.count - 1] < 0) d->out.count--;
+
+    const int ni = regex_intern(d, &d->out, next);
+    if (d->flushes == flushes) d->states.items[si].next[c] = ni;
+    return ni;
+}
+
+// works out every transition of `si` to see how to get through it fast:
+// when only a few bytes leave it they are looked for with scan_any(), else
+// the bytes staying in it are just checked one after the other without
+// waiting on the state. Not done when it could flush the cache
+static void regex_accelerate(Regex *re, RegexDfa *d, int si)
+{
+    d->states.items[si].flags &= ~STATE_CHECK;
+    if (d->states.count + 256 > REGEX_MAX_STATES) return;
+
+    char bytes[3];
+    size_t k = 0;
+    for (int c=0; c<256; c++)
+    {
+        int next = d->states.items[si].next[c];
+        if (next < 0) next = regex_step(re, d, si, c);
+        if (next == si) continue;
+        if (k < 3) bytes[k] = c;
+        k++;
+    }
+    if (k == 256) return;
+
+    RegexState *s = &d->states.items[si];
+    if (k > 0 && k <= 3)
+    {
+        memcpy(s->skipBytes, bytes, k);
+        s->skip = k;
+    }
+    s->flags |= STATE_SKIP;
+}
+
+// ---------------------------------------------------------------------------
+
+void regex_init(Regex *re)
+{
+    *re = (Regex) {0};
+    da_init(&re->classes);
+    regex_dfa_init(&re->forward);
+    regex_dfa_init(&re->reverse);
+    re->reverse.anchored = true;
+}
+
+void regex_free(Regex *re)
+{
+    da_free(&re->classes);
+    regex_dfa_free(&re->forward);
+    regex_dfa_free(&re->reverse);
+}
+
+bool regex_compile(Regex *re, const char *pattern, size_t n)
+{
+    re->error[0] = '\0';
+    re->classes.count = 0;
+    re->forward.prog.count = 0;
+    re->reverse.prog.count = 0;
+
+    RegexParser p = { .re = re, .pattern = pattern, .n = n };
+    da_init(&p.nodes);
+    int root = regex_parse_alt(&p);
+    if (root >= 0 && p.i < n) root = regex_fail(&p, "unmatched )");
+
+    bool ok = root >= 0;
+    if (ok)
+    {
+        ok = regex_emit(&re->forward.prog, &p.nodes, root, false) &&
+             regex_emit(&re->reverse.prog, &p.nodes, root, true);
+        if (!ok) regex_fail(&p, "pattern too big");
+    }
+    da_free(&p.nodes);
+    if (!ok) return false;
+
+    regex_inst(&re->forward.prog, REGEX_MATCH, 0, 0);
+    regex_inst(&re->reverse.prog, REGEX_MATCH, 0, 0);
+    regex_dfa_reset(&re->forward);
+    regex_dfa_reset(&re->reverse);
+    return true;
+}
+
+void regex_scan_start(RegexScan *s, const Piece *pieces, size_t count, size_t pos)
+{
+    *s = (RegexScan) { .pieces = pieces, .count = count, .prev = '\n', .state = -1 };
+    while (s->piece < count && pos >= pieces[s->piece].len)
+    {
+        const Piece *p = &pieces[s->piece++];
+        if (p->len > 0) s->prev = p->data[p->len - 1];
+        pos -= p->len;
+        s->pos += p->len;
+    }
+    if (s->piece == count) return;
+    s->offset = pos;
+    s->pos += pos;
+    if (pos > 0) s->prev = pieces[s->piece].data[pos - 1];
+}
+
+// walks back from the end of the match found to where it starts
+static size_t regex_reverse(Regex *re, const RegexScan *s)
+{
+    RegexDfa *d = &re->reverse;
+    size_t piece = s->endPiece;
+    size_t offset = s->endOffset;
+    const bool bol = piece == s->count || s->pieces[piece].data[offset] == '\n';
+
+    int si = regex_start(d, bol);
+    size_t pos = s->end;
+    size_t start = s->end;
+    for (;;)
+    {
+        while (offset == 0 && piece > 0) offset = s->pieces[--piece].len;
+        const uint8_t flags = d->states.items[si].flags;
+        if (flags & STATE_DEAD) break;
+
+        const bool first = offset == 0; // the start of the text
+        const unsigned char c = first ? '\n' : s->pieces[piece].data[offset - 1];
+        if ((flags & STATE_MATCH) || ((flags & STATE_MATCH_EOL) && c == '\n')) start = pos;
+        if (first || pos == s->from) break;
+
+        int next = d->states.items[si].next[c];
+        if (next < 0) next = regex_step(re, d, si, c);
+        si = next;
+        offset--;
+        pos--;
+    }
+    return start;
+}
+
+bool regex_scan_next(Regex *re, RegexScan *s, size_t *budget, size_t *start, size_t *end)
+{
+    RegexDfa *d = &re->forward;
+    while (!s->done)
+    {
+        if (s->state < 0)
+        {
+            s->state = regex_start(d, s->prev == '\n');
+            s->from = s->pos;
+            s->end = SIZE_MAX;
+        }
+
+        // forwards to where the leftmost-longest match ends
+        bool dead = false;
+        while (!dead && s->piece < s->count)
+        {
+            if (*budget == 0) return false;
+            const Piece *p = &s->pieces[s->piece];
+            size_t stop = p->len;
+            if (stop - s->offset > *budget) stop = s->offset + *budget;
+
+            int si = s->state;
+            size_t i = s->offset;
+            for (; i < stop; i++)
+            {
+                unsigned char c = p->data[i];
+                const RegexState *st = &d->states.items[si];
+                if (st->flags & STATE_SLOW)
+                {
+                    if (st->flags & STATE_DEAD)
+                    {
+                        dead = true;
+                        break;
+                    }
+                    if (st->flags & STATE_CHECK)
+                    {
+                        regex_accelerate(re, d, si);
+                        st = &d->states.items[si];
+                    }
+                    if (st->flags & STATE_SKIP)
+                    {
+                        if (st->skip > 0)
+                            i += scan_any(p->data + i, stop - i, st->skipBytes, st->skip);
+                        else
+                            while (i < stop && st->next[(unsigned char)p->data[i]] == si) i++;
+                        if (i == stop) break;
+                        c = p->data[i];
+                    }
+                    if ((st->flags & STATE_MATCH) || ((st->flags & STATE_MATCH_EOL) && c == '\n'))
+                    {
+                        s->end = s->pos + (i - s->offset);
+                        s->endPiece = s->piece;
+                        s->endOffset = i;
+                        s->endPrev = i > 0 ? p->data[i - 1] : s->prev;
+                    }
+                }
+                int next = st->next[c];
+                if (next < 0) next = regex_step(re, d, si, c);
+                si = next;
+            }
+
+            *budget -= i - s->offset;
+            if (i > s->offset) s->prev = p->data[i - 1];
+            s->pos += i - s->offset;
+            s->offset = i;
+            s->state = si;
+            if (s->offset == p->len)
+            {
+                s->piece++;
+                s->offset = 0;
+            }
+        }
+        if (!dead && (d->states.items[s->state].flags & (STATE_MATCH | STATE_MATCH_EOL)))
+        {   // the end of the text ends the last line
+            s->end = s->pos;
+            s->endPiece = s->count;
+            s->endOffset = 0;
+            s->endPrev = s->prev;
+        }
+        s->state = -1;
+        if (s->end == SIZE_MAX)
+        {
+            s->done = true;
+            return false;
+        }
+
+        const size_t matchStart = regex_reverse(re, s);
+        const size_t matchEnd = s->end;
+        *budget -= matchEnd - matchStart < *budget ? matchEnd - matchStart : *budget;
+
+        // the next match is looked for after this one
+        s->piece = s->endPiece;
+        s->offset = s->endOffset;
+        s->pos = matchEnd;
+        s->prev = s->endPrev;
+        if (matchStart == matchEnd)
+        {   // empty matches are no use, move on a byte
+            while (s->piece < s->count && s->offset == s->pieces[s->piece].len)
+            {
+                s->piece++;
+                s->offset = 0;
+            }
+            if (s->piece == s->count)
+            {
+                s->done = true;
+                return false;
+            }
+            s->prev = s->pieces[s->piece].data[s->offset++];
+            s->pos++;
+            if (s->offset == s->pieces[s->piece].len)
+            {
+                s->piece++;
+                s->offset = 0;
+            }
+            continue;
+        }
+
+        *start = matchStart;
+        *end = matchEnd;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,140 @@
+#pragma once
+/*
+ * Regular expressions
+ *
+ * Supports literals, `.`, classes (`[a-z]`, `[^0-9]`, `\d \w \s` and their
+ * negations), groups, `|`, `* + ?`, `{m}`, `{m,}`, `{m,n}` and the line
+ * anchors `^ $`. Works on bytes, `.` matches anything but '\n'.
+ *
+ * A pattern is compiled to a Thompson NFA twice, once forwards and once
+ * reversed. Searching runs a DFA built lazily from the NFA: each DFA state
+ * is the set of NFA states the text can be in, its transitions are worked
+ * out the first time they are taken and cached. When the cache fills up it
+ * is thrown away and rebuilt, so memory stays bounded and time stays linear
+ * in the size of the text whatever the pattern.
+ *
+ * The forward DFA finds where the leftmost-longest match ends (the NFA
+ * states are kept in groups ordered by where their match started, groups
+ * behind a matching one are dropped), the reversed one then runs back from
+ * there to find where it starts. Both read the pieces of the buffer as they
+ * are, and a search gives up after a byte budget and picks up again where
+ * it stopped on the next call.
+ */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer.h"
+
+#define REGEX_MAX_INSTS  8192 // program size limit, big counted repetitions hit it
+#define REGEX_MAX_STATES 1024 // DFA states cached before the cache is flushed
+
+typedef enum {
+    REGEX_CLASS, // consumes a byte of class x
+    REGEX_SPLIT, // goes on at x and at y
+    REGEX_JUMP,  // goes on at x
+    REGEX_BOL,   // at the start of a line
+    REGEX_EOL,   // at the end of a line
+    REGEX_MATCH,
+} RegexOp;
+
+typedef struct {
+    RegexOp op;
+    int     x;
+    int     y;
+} RegexInst;
+
+typedef struct {
+    RegexInst *items;
+    size_t size;
+    size_t count;
+} RegexProg;
+
+typedef struct {
+    uint32_t bits[8]; // one bit per byte value
+} RegexClass;
+
+typedef struct {
+    RegexClass *items;
+    size_t size;
+    size_t count;
+} RegexClasses;
+
+typedef struct {
+    int   *items;
+    size_t size;
+    size_t count;
+} RegexInts;
+
+typedef struct {
+    int     next[256]; // state after each byte, -1 until it is worked out
+    size_t  threads;   // first NFA state in RegexDfa.threads
+    size_t  count;     // NFA states and group separators (-1)
+    uint8_t flags;
+    uint8_t skip;      // number of skipBytes, the only bytes leading elsewhere
+    char    skipBytes[3];
+} RegexState;
+
+typedef struct {
+    RegexState *items;
+    size_t size;
+    size_t count;
+} RegexStates;
+
+// the lazily built DFA of one program
+typedef struct {
+    RegexProg   prog;
+    bool        anchored; // matches start where the search starts
+    bool        lines;    // the program has ^ or $, a '\n' changes the state
+    RegexStates states;
+    RegexInts   threads;  // NFA states of all DFA states
+    RegexInts   table;    // hash table of DFA states, index + 1
+    int         starts[2]; // state a search starts in, after a '\n' or not
+    size_t      flushes;
+
+    // scratch for building states
+    RegexInts   stamps;   // per NFA state, generation it was last added in
+    int         generation;
+    RegexInts   stack;
+    RegexInts   work;
+    RegexInts   expanded;
+    RegexInts   out;
+} RegexDfa;
+
+typedef struct {
+    RegexClasses classes;
+    RegexDfa     forward;
+    RegexDfa     reverse;
+    char         error[64]; // why the pattern did not compile
+} Regex;
+
+void regex_init(Regex *re);
+void regex_free(Regex *re);
+// false with re->error set when the pattern is malformed
+bool regex_compile(Regex *re, const char *pattern, size_t n);
+
+// a search going through the text made of `pieces`
+typedef struct {
+    const Piece *pieces;
+    size_t       count;
+
+    // the next byte looked at
+    size_t piece;
+    size_t offset;
+    size_t pos;
+    char   prev;   // the byte before it
+    int    state;  // DFA state, -1 when the next match is looked for from pos
+    size_t from;   // where the match being looked for may start
+    bool   done;
+
+    // end of the longest match found so far for the current start
+    size_t end;
+    size_t endPiece;
+    size_t endOffset;
+    char   endPrev;
+} RegexScan;
+
+void regex_scan_start(RegexScan *s, const Piece *pieces, size_t count, size_t pos);
+// finds the next match [start, end), empty ones are skipped. Returns false
+// when the budget (in bytes) ran out first, or at the end of the text with
+// s->done set. The pieces may be replaced by an equal copy between calls
+bool regex_scan_next(Regex *re, RegexScan *s, size_t *budget, size_t *start, size_t *end);
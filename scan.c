@@ -0,0 +1,237 @@
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+static size_t scan_newline_scalar(const char *text, size_t n)
+{
+    for (size_t i=0; i<n; i++)
+        if (text[i] == '\n') return i;
+    return n;
+}
+
+static size_t scan_count_newlines_scalar(const char *text, size_t n)
+{
+    size_t count = 0;
+    for (size_t i=0; i<n; i++)
+        count += text[i] == '\n';
+    return count;
+}
+
+static size_t scan_find_scalar(const char *text, size_t n, const char *needle, size_t m)
+{
+    for (size_t i=0; i + m <= n; i++)
+        if (text[i] == needle[0] && memcmp(text + i, needle, m) == 0) return i;
+    return n;
+}
+
+static size_t scan_any_scalar(const char *text, size_t n, const char *bytes)
+{
+    for (size_t i=0; i<n; i++)
+        if (text[i] == bytes[0] || text[i] == bytes[1] || text[i] == bytes[2]) return i;
+    return n;
+}
+
+#ifdef SCAN_X86
+__attribute__((target("sse2")))
+static size_t scan_newline_sse2(const char *text, size_t n)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_newline_scalar(text + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_count_newlines_sse2(const char *text, size_t n)
+{
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, nl)));
+    }
+    return count + scan_count_newlines_scalar(text + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_find_sse2(const char *text, size_t n, const char *needle, size_t m)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= n; i += 16)
+    {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i)), first);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(text + i + m - 1)), last);
+        for (unsigned mask = _mm_movemask_epi8(_mm_and_si128(a, b)); mask; mask &= mask - 1)
+        {
+            const size_t at = i + __builtin_ctz(mask);
+            if (m <= 2 || memcmp(text + at + 1, needle + 1, m - 2) == 0) return at;
+        }
+    }
+    return i + scan_find_scalar(text + i, n - i, needle, m);
+}
+
+__attribute__((target("sse2")))
+static size_t scan_any_sse2(const char *text, size_t n, const char *bytes)
+{
+    const __m128i a = _mm_set1_epi8(bytes[0]);
+    const __m128i b = _mm_set1_epi8(bytes[1]);
+    const __m128i c = _mm_set1_epi8(bytes[2]);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, a), _mm_cmpeq_epi8(chunk, b)), _mm_cmpeq_epi8(chunk, c));
+        unsigned mask = _mm_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_any_scalar(text + i, n - i, bytes);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_newline_avx2(const char *text, size_t n)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    // most lines are short, the first 16 bytes get checked on their own
+    if (n >= 16)
+    {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)text), _mm256_castsi256_si128(nl)));
+        if (mask) return __builtin_ctz(mask);
+        i = 16;
+    }
+    // then two vectors per iteration for the long ones
+    for (; i + 64 <= n; i += 64)
+    {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i)), nl);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i + 32)), nl);
+        if (!_mm256_testz_si256(_mm256_or_si256(a, b), _mm256_or_si256(a, b)))
+        {
+            uint64_t mask = (uint32_t)_mm256_movemask_epi8(a) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(b) << 32);
+            return i + __builtin_ctzll(mask);
+        }
+    }
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_newline_scalar(text + i, n - i);
+}
+
+__attribute__((target("avx2,popcnt")))
+static size_t scan_count_newlines_avx2(const char *text, size_t n)
+{
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, nl)));
+    }
+    return count + scan_count_newlines_scalar(text + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_find_avx2(const char *text, size_t n, const char *needle, size_t m)
+{
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= n; i += 32)
+    {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i)), first);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(text + i + m - 1)), last);
+        for (unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(a, b)); mask; mask &= mask - 1)
+        {
+            const size_t at = i + __builtin_ctz(mask);
+            if (m <= 2 || memcmp(text + at + 1, needle + 1, m - 2) == 0) return at;
+        }
+    }
+    return i + scan_find_scalar(text + i, n - i, needle, m);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_any_avx2(const char *text, size_t n, const char *bytes)
+{
+    const __m256i a = _mm256_set1_epi8(bytes[0]);
+    const __m256i b = _mm256_set1_epi8(bytes[1]);
+    const __m256i c = _mm256_set1_epi8(bytes[2]);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, a), _mm256_cmpeq_epi8(chunk, b)), _mm256_cmpeq_epi8(chunk, c));
+        unsigned mask = _mm256_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + scan_any_scalar(text + i, n - i, bytes);
+}
+#endif
+
+static size_t (*scan_newline_impl)(const char *, size_t) = scan_newline_scalar;
+static size_t (*scan_count_newlines_impl)(const char *, size_t) = scan_count_newlines_scalar;
+static size_t (*scan_find_impl)(const char *, size_t, const char *, size_t) = scan_find_scalar;
+static size_t (*scan_any_impl)(const char *, size_t, const char *) = scan_any_scalar;
+
+#ifdef SCAN_X86
+// runs before main(), so worker threads never race on picking the implementation
+__attribute__((constructor))
+static void scan_resolve(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        scan_newline_impl = scan_newline_avx2;
+        scan_count_newlines_impl = scan_count_newlines_avx2;
+        scan_find_impl = scan_find_avx2;
+        scan_any_impl = scan_any_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2"))
+    {
+        scan_newline_impl = scan_newline_sse2;
+        scan_count_newlines_impl = scan_count_newlines_sse2;
+        scan_find_impl = scan_find_sse2;
+        scan_any_impl = scan_any_sse2;
+    }
+}
+#endif
+
+size_t scan_newline(const char *text, size_t n)
+{
+    return scan_newline_impl(text, n);
+}
+
+size_t scan_count_newlines(const char *text, size_t n)
+{
+    return scan_count_newlines_impl(text, n);
+}
+
+size_t scan_find(const char *text, size_t n, const char *needle, size_t m)
+{
+    if (m == 0) return 0;
+    if (m > n) return n;
+    return scan_find_impl(text, n, needle, m);
+}
+
+size_t scan_any(const char *text, size_t n, const char *bytes, size_t k)
+{
+    // fewer bytes just repeat the last one
+    const char three[3] = { bytes[0], bytes[k > 1 ? 1 : 0], bytes[k - 1] };
+    return scan_any_impl(text, n, three);
+}
@@ -0,0 +1,20 @@
+#pragma once
+/*
+ * Vectorized byte scanning
+ *
+ * On x86 the best available implementation (AVX2, SSE2) is picked at startup,
+ * everything else gets the plain scalar loop.
+ */
+#include <stddef.h>
+
+// returns offset of the first '\n' in text[0..n), or n if there is none
+size_t scan_newline(const char *text, size_t n);
+// returns the number of '\n' in text[0..n)
+size_t scan_count_newlines(const char *text, size_t n);
+// returns offset of the first occurrence of needle[0..m) in text[0..n), or n
+// if there is none. Candidates are filtered on the first and last byte of
+// the needle a whole vector at a time, only those get compared in full
+size_t scan_find(const char *text, size_t n, const char *needle, size_t m);
+// returns offset of the first byte in text[0..n) that is one of bytes[0..k),
+// 1 <= k <= 3, or n if there is none
+size_t scan_any(const char *text, size_t n, const char *bytes, size_t k);
@@ -0,0 +1,406 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "search.h"
+#include "dynamic_array.h"
+#include "regex.h"
+#include "scan.h"
+#include "arena.h"
+
+// copies up to `n` bytes starting `offset` bytes into piece `k`, returns how
+// many there were
+static size_t search_copy(const Piece *pieces, size_t count, size_t k, size_t offset, size_t n, char *dest)
+{
+    size_t copied = 0;
+    for (; k < count && copied < n; k++, offset = 0)
+    {
+        size_t len = pieces[k].len - offset;
+        if (len > n - copied) len = n - copied;
+        memcpy(dest + copied, pieces[k].data + offset, len);
+        copied += len;
+    }
+    return copied;
+}
+
+static void search_add(SearchMatches *m, size_t start, size_t end)
+{
+    da_append(m, ((SearchMatch) { start, end }));
+}
+
+// where a literal search is in the pieces
+typedef struct {
+    size_t piece;
+    size_t offset; // next match start looked at in the piece
+    size_t pos;    // of the piece in the text
+} LiteralCursor;
+
+// matches of needle[0..m) starting in about the next `budget` bytes, returns
+// how many bytes it went through. `window` holds 2*(m-1) bytes
+static size_t search_literal(LiteralCursor *c, const Piece *pieces, size_t count, const char *needle, size_t m,
+                             char *window, size_t budget, SearchMatches *out)
+{
+    size_t looked = 0;
+    while (c->piece < count && looked < budget)
+    {
+        const Piece *p = &pieces[c->piece];
+        const size_t last = p->len >= m ? p->len - m + 1 : 0; // matches starting before it fit in the piece
+        if (c->offset < last)
+        {
+            size_t stop = last;
+            if (stop - c->offset > budget - looked) stop = c->offset + budget - looked;
+            for (size_t i=c->offset; i<stop;)
+            {
+                const size_t at = i + scan_find(p->data + i, stop - i + m - 1, needle, m);
+                if (at >= stop) break;
+                search_add(out, c->pos + at, c->pos + at + m);
+                i = at + 1;
+            }
+            looked += stop - c->offset;
+            c->offset = stop;
+            if (stop < last) break; // out of budget
+        }
+
+        // matches starting in the last m-1 bytes run into the next pieces
+        if (m > 1 && p->len > 0 && c->piece + 1 < count)
+        {
+            const size_t before = p->len < m - 1 ? p->len : m - 1;
+            const size_t n = search_copy(pieces, count, c->piece, p->len - before, before + m - 1, window);
+            for (size_t i=0; i<before;)
+            {
+                const size_t at = i + scan_find(window + i, n - i, needle, m);
+                if (at >= before || at + m > n) break;
+                search_add(out, c->pos + p->len - before + at, c->pos + p->len - before + at + m);
+                i = at + 1;
+            }
+        }
+        c->pos += p->len;
+        c->piece++;
+        c->offset = 0;
+    }
+    return looked;
+}
+
+// ---------------------------------------------------------------------------
+// Worker
+
+static void *search_worker(void *arg)
+{
+    SearchWorker *w = arg;
+    Pieces pieces = {0};
+    SearchText query = {0};
+    SearchText window = {0};
+    SearchMatches batch = {0};
+    Regex re;
+    regex_init(&re);
+
+    pthread_mutex_lock(&w->lock);
+    for (;;)
+    {
+        while (!w->pending && !w->quit) pthread_cond_wait(&w->wake, &w->lock);
+        if (w->quit) break;
+
+        // take the job over, the editor is free to post the next one
+        w->pending = false;
+        w->running = true;
+        const size_t generation = w->jobGeneration;
+        const bool regex = w->regex;
+        da_reserve(&pieces, w->pieces.count);
+        memcpy(pieces.items, w->pieces.items, w->pieces.count*sizeof(Piece));
+        pieces.count = w->pieces.count;
+        da_reserve(&query, w->query.count);
+        if (w->query.count > 0) memcpy(query.items, w->query.items, w->query.count);
+        query.count = w->query.count;
+        pthread_mutex_unlock(&w->lock);
+
+        const size_t m = query.count;
+        char error[64] = "";
+        bool done = m == 0;
+        RegexScan scan = {0};
+        LiteralCursor cursor = {0};
+        if (!done && regex)
+        {
+            if (regex_compile(&re, query.items, m))
+                regex_scan_start(&scan, pieces.items, pieces.count, 0);
+            else
+            {
+                snprintf(error, sizeof(error), "%s", re.error);
+                done = true;
+            }
+        }
+        else if (!done)
+        {
+            da_reserve(&window, 2*(m - 1));
+        }
+
+        size_t found = 0;
+        bool complete = true;
+        do
+        {
+            batch.count = 0;
+            size_t looked = 0;
+            if (!done && regex)
+            {
+                const size_t pos = scan.pos;
+                size_t budget = SEARCH_BATCH_BYTES;
+                size_t start, end;
+                while (found + batch.count < SEARCH_MAX_MATCHES && regex_scan_next(&re, &scan, &budget, &start, &end))
+                    search_add(&batch, start, end);
+                looked = scan.pos - pos;
+                done = scan.done;
+            }
+            else if (!done)
+            {
+                looked = search_literal(&cursor, pieces.items, pieces.count, query.items, m,
+                                        window.items, SEARCH_BATCH_BYTES, &batch);
+                done = cursor.piece == pieces.count;
+            }
+            if (found + batch.count >= SEARCH_MAX_MATCHES)
+            {   // the rest of the text is not searched
+                batch.count = SEARCH_MAX_MATCHES - found;
+                complete = false;
+                done = true;
+            }
+            found += batch.count;
+
+            bool notify = false;
+            pthread_mutex_lock(&w->lock);
+            if (atomic_load(&w->generation) == generation)
+            {
+                SearchMatches *matches = &w->matches;
+                if (matches->size < matches->count + batch.count) da_reserve(matches, (matches->count + batch.count)*2);
+                if (batch.count > 0) memcpy(matches->items + matches->count, batch.items, batch.count*sizeof(SearchMatch));
+                matches->count += batch.count;
+                w->looked += looked;
+                w->complete = complete;
+                memcpy(w->error, error, sizeof(error));
+                w->done = done;
+                notify = w->notify != NULL && !w->notified;
+                w->notified = true;
+            }
+            pthread_mutex_unlock(&w->lock);
+            if (notify) w->notify();
+        } while (!done && atomic_load(&w->generation) == generation);
+
+        pthread_mutex_lock(&w->lock);
+        w->running = false;
+        pthread_cond_broadcast(&w->idle);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    da_free(&pieces);
+    da_free(&query);
+    da_free(&window);
+    da_free(&batch);
+    regex_free(&re);
+    return NULL;
+}
+
+// drops the job, the worker notices it after its current batch
+static void search_cancel(Search *s)
+{
+    atomic_fetch_add(&s->worker.generation, 1);
+    s->jobActive = false;
+}
+
+// hands the search for query[0..n) in `b` to the worker
+static void search_post(Search *s, Buffer *b, const char *query, size_t n, bool regex)
+{
+    SearchWorker *w = &s->worker;
+    search_cancel(s);
+    s->matches.count = 0;
+    s->longest = 0;
+    s->complete = true;
+    s->error[0] = '\0';
+    s->looked = 0;
+    if (!w->started)
+    {
+        w->started = pthread_create(&w->thread, NULL, search_worker, w) == 0;
+        if (!w->started)
+        {
+            snprintf(s->error, sizeof(s->error), "no search thread");
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&w->lock);
+    w->jobGeneration = atomic_fetch_add(&w->generation, 1) + 1;
+    w->pending = true;
+    // piece data never changes until the buffer is freed, copying the
+    // pieces is enough for a snapshot
+    da_reserve(&w->pieces, b->pieces.count);
+    memcpy(w->pieces.items, b->pieces.items, b->pieces.count*sizeof(Piece));
+    w->pieces.count = b->pieces.count;
+    da_reserve(&w->query, n);
+    if (n > 0) memcpy(w->query.items, query, n);
+    w->query.count = n;
+    w->regex = regex;
+    w->matches.count = 0;
+    w->looked = 0;
+    w->complete = true;
+    w->error[0] = '\0';
+    w->done = false;
+    w->notified = false;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    s->jobActive = true;
+}
+
+// ---------------------------------------------------------------------------
+
+void search_init(Search *s)
+{
+    *s = (Search) {0};
+    da_init(&s->query);
+    da_init(&s->matches);
+    da_init(&s->window);
+    da_init(&s->worker.pieces);
+    da_init(&s->worker.query);
+    da_init(&s->worker.matches);
+    pthread_mutex_init(&s->worker.lock, NULL);
+    pthread_cond_init(&s->worker.wake, NULL);
+    pthread_cond_init(&s->worker.idle, NULL);
+    atomic_init(&s->worker.generation, 0);
+}
+
+void search_free(Search *s)
+{
+    SearchWorker *w = &s->worker;
+    search_stop(s);
+    if (w->started)
+    {
+        pthread_mutex_lock(&w->lock);
+        w->quit = true;
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+    }
+    pthread_cond_destroy(&w->idle);
+    pthread_cond_destroy(&w->wake);
+    pthread_mutex_destroy(&w->lock);
+    da_free(&w->pieces);
+    da_free(&w->query);
+    da_free(&w->matches);
+    da_free(&s->query);
+    da_free(&s->matches);
+    da_free(&s->window);
+}
+
+void search_clear(Search *s)
+{
+    search_cancel(s);
+    s->query.count = 0;
+    s->matches.count = 0;
+    s->longest = 0;
+    s->valid = false;
+}
+
+void search_stop(Search *s)
+{
+    SearchWorker *w = &s->worker;
+    search_cancel(s);
+    if (!w->started) return;
+
+    pthread_mutex_lock(&w->lock);
+    w->pending = false;
+    while (w->running) pthread_cond_wait(&w->idle, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+bool search_busy(Search *s)
+{
+    if (s->jobActive) return true;
+    if (!s->worker.started) return false;
+    // a cancelled job runs until the end of its batch
+    pthread_mutex_lock(&s->worker.lock);
+    const bool running = s->worker.running;
+    pthread_mutex_unlock(&s->worker.lock);
+    return running;
+}
+
+// keeps the matches that go on with query[from..n)
+static size_t search_refine(Search *s, Buffer *b, const char *query, size_t from, size_t n)
+{
+    const size_t extra = n - from;
+    da_reserve(&s->window, extra);
+
+    size_t kept = 0;
+    for (size_t i=0; i<s->matches.count; i++)
+    {
+        const size_t pos = s->matches.items[i].start;
+        if (pos + n > b->count) continue;
+        buffer_copy(b, pos + from, extra, s->window.items);
+        if (memcmp(s->window.items, query + from, extra) == 0)
+            s->matches.items[kept++] = (SearchMatch) { pos, pos + n };
+    }
+    const size_t looked = s->matches.count*extra;
+    s->matches.count = kept;
+    s->longest = n;
+    return looked;
+}
+
+bool search_update(Search *s, Buffer *b, const char *query, size_t n, bool regex)
+{
+    const bool same = s->valid && s->version == b->version && s->regex == regex;
+    if (same && s->query.count == n && (n == 0 || memcmp(s->query.items, query, n) == 0)) return false;
+
+    // a longer query only matches where the shorter one did, while there are
+    // few of them that is quicker than searching again
+    if (same && !regex && !s->jobActive && s->complete && s->error[0] == '\0' &&
+        s->query.count > 0 && n > s->query.count && s->matches.count <= SEARCH_REFINE_MAX &&
+        memcmp(s->query.items, query, s->query.count) == 0)
+    {
+        s->looked = search_refine(s, b, query, s->query.count, n);
+    }
+    else
+    {
+        search_post(s, b, query, n, regex);
+    }
+
+    da_reserve(&s->query, n);
+    if (n > 0) memcpy(s->query.items, query, n);
+    s->query.count = n;
+    s->regex = regex;
+    s->version = b->version;
+    s->valid = true;
+    return true;
+}
+
+bool search_take(Search *s)
+{
+    if (!s->jobActive) return false;
+    SearchWorker *w = &s->worker;
+
+    pthread_mutex_lock(&w->lock);
+    w->notified = false;
+    const size_t count = w->matches.count;
+    if (s->matches.size < s->matches.count + count) da_reserve(&s->matches, (s->matches.count + count)*2);
+    for (size_t i=0; i<count; i++)
+    {
+        const SearchMatch match = w->matches.items[i];
+        if (match.end - match.start > s->longest) s->longest = match.end - match.start;
+        s->matches.items[s->matches.count++] = match;
+    }
+    w->matches.count = 0;
+    s->looked = w->looked;
+    s->complete = w->complete;
+    memcpy(s->error, w->error, sizeof(s->error));
+    const bool finished = w->done;
+    pthread_mutex_unlock(&w->lock);
+
+    if (finished) s->jobActive = false;
+    return count > 0 || finished;
+}
+
+size_t search_lower_bound(Search *s, size_t pos)
+{
+    size_t lo = 0, hi = s->matches.count;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo)/2;
+        if (s->matches.items[mid].start < pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
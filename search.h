@@ -0,0 +1,117 @@
+#pragma once
+/*
+ * Find
+ *
+ * Every match of a query in the buffer, sorted by position. A literal query
+ * is looked for piece by piece with scan_find() (matches may overlap), a
+ * match running over the end of a piece is looked for in a small copy of the
+ * text around the boundary, so the text is never put together in one place.
+ * A regex query goes through regex.h, which reads the pieces as they are too.
+ *
+ * The search runs on a worker thread over a snapshot of the pieces. After
+ * every SEARCH_BATCH_BYTES it hands over the matches found so far and checks
+ * that its job is still wanted, a new query or an edit cancels the job and
+ * posts a new one. search_take() moves the matches over to the editor, which
+ * shows them and jumps to them while the rest is still being searched. The
+ * worker can wake the event loop through `notify` when it handed some over.
+ *
+ * While a literal query is typed it usually just gets longer, then only the
+ * previous matches are checked for the new bytes, right away, instead of
+ * searching the whole buffer again.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "buffer.h"
+
+#define SEARCH_MAX_MATCHES (1 << 22) // the rest of the text is not searched
+#define SEARCH_BATCH_BYTES (1 << 20) // searched by the worker between checks for a cancel
+#define SEARCH_REFINE_MAX  (1 << 16) // more matches than this get searched for again instead
+
+typedef struct {
+    size_t start;
+    size_t end;
+} SearchMatch;
+
+typedef struct {
+    SearchMatch *items;
+    size_t size;
+    size_t count;
+} SearchMatches;
+
+typedef struct {
+    char  *items;
+    size_t size;
+    size_t count;
+} SearchText;
+
+typedef struct {
+    pthread_t       thread;
+    bool            started;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake; // a job got posted, or the worker has to quit
+    pthread_cond_t  idle; // the worker stopped reading its snapshot
+
+    // bumped for every job and to cancel one, the worker drops its results
+    // as soon as it does not match the job's anymore
+    atomic_size_t generation;
+
+    // the job, set by the editor under the lock
+    size_t     jobGeneration;
+    bool       pending;
+    bool       quit;
+    Pieces     pieces; // snapshot of the buffer
+    SearchText query;
+    bool       regex;
+
+    // appended by the worker under the lock, the editor takes them out
+    SearchMatches matches;
+    size_t        looked;    // bytes searched so far
+    bool          complete;  // false when it stopped at SEARCH_MAX_MATCHES
+    char          error[64]; // why the regex did not compile
+    bool          running;   // reading the snapshot
+    bool          done;      // the job is finished
+
+    // called on the worker thread after it handed over matches (or
+    // progress), at most once until they get taken. NULL when nobody needs
+    // waking, set before the first update
+    void (*notify)(void);
+    bool   notified;
+} SearchWorker;
+
+typedef struct {
+    SearchText    query;   // the matches are of this query
+    bool          regex;   // the query is a regex
+    SearchMatches matches; // sorted by start
+    size_t        longest; // length of the longest match
+    size_t        version; // of the buffer the matches were found in
+    bool          valid;
+    bool          jobActive; // more matches may come from the worker
+    bool          complete;  // false when it stopped at SEARCH_MAX_MATCHES
+    char          error[64]; // why the regex did not compile, empty if it did
+    size_t        looked;    // bytes looked at for the matches
+
+    SearchText   window; // text copied out of the buffer
+    SearchWorker worker;
+} Search;
+
+void   search_init(Search *s);
+void   search_free(Search *s);
+// forgets the matches
+void   search_clear(Search *s);
+// cancels the worker and waits until it let go of its snapshot, needed
+// before the buffer memory gets freed
+void   search_stop(Search *s);
+// the worker is searching (or still finishing a cancelled job and
+// allocating)
+bool   search_busy(Search *s);
+
+// starts looking for the matches of `query` in `b`, returns false when they
+// are known (or being looked for) already
+bool   search_update(Search *s, Buffer *b, const char *query, size_t n, bool regex);
+// takes in the matches the worker found so far, returns true when there
+// were new ones or the job finished
+bool   search_take(Search *s);
+// index of the first match starting at or after `pos`, matches.count if none
+size_t search_lower_bound(Search *s, size_t pos);
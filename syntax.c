@@ -0,0 +1,750 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "syntax.h"
+#include "dynamic_array.h"
+#include "scan.h"
+#include "arena.h"
+
+#define SYNTAX_BATCH 1024 // lines the worker lexes between publishing them
+
+// ---------------------------------------------------------------------------
+// Helpers shared by the lexers
+
+static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static bool is_word_start(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+static bool is_word(char c) { return is_word_start(c) || is_digit(c); }
+
+// starts a token at `start`, a token of the same kind just continues
+static void emit(Tokens *tokens, size_t start, TokenKind kind)
+{
+    if (tokens == NULL) return;
+    if (tokens->count > 0 && tokens->items[tokens->count - 1].kind == kind) return;
+    da_append(tokens, ((Token){ start, kind }));
+}
+
+static bool word_in(const char *word, size_t n, const char *const *words)
+{
+    for (; *words != NULL; words++)
+        if (strlen(*words) == n && memcmp(*words, word, n) == 0)
+            return true;
+    return false;
+}
+
+static size_t word_end(const char *text, size_t n, size_t i)
+{
+    while (i < n && is_word(text[i])) i++;
+    return i;
+}
+
+// returns the end of the string opened by `quote` before `i`, `closed` tells
+// if the line ended first
+static size_t string_end(const char *text, size_t n, size_t i, char quote, bool *closed)
+{
+    while (i < n)
+    {
+        if (text[i] == '\\') i += 2;
+        else if (text[i++] == quote)
+        {
+            *closed = true;
+            return i;
+        }
+    }
+    *closed = false;
+    return n;
+}
+
+// returns the end of the number starting at `i`, hex, floats and suffixes included
+static size_t number_end(const char *text, size_t n, size_t i)
+{
+    for (i++; i < n; i++)
+    {
+        const char c = text[i];
+        const char prev = text[i-1];
+        const bool exponent = (c == '+' || c == '-') &&
+            (prev == 'e' || prev == 'E' || prev == 'p' || prev == 'P');
+        if (!is_word(c) && c != '.' && !exponent) break;
+    }
+    return i;
+}
+
+// ---------------------------------------------------------------------------
+// C
+
+enum { C_CODE, C_COMMENT, C_STRING };
+
+static const char *const cKeywords[] = {
+    "break", "case", "continue", "default", "do", "else", "for", "goto", "if",
+    "return", "sizeof", "switch", "while", "typedef", "struct", "union", "enum",
+    "static", "extern", "const", "volatile", "inline", "register", "restrict",
+    "_Alignas", "_Alignof", "_Static_assert", "_Thread_local", "_Atomic",
+    "true", "false", "NULL", NULL,
+};
+
+static const char *const cTypes[] = {
+    "void", "char", "short", "int", "long", "float", "double", "signed",
+    "unsigned", "bool", "_Bool", "size_t", "ptrdiff_t", "int8_t", "int16_t",
+    "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+    "uintptr_t", "intptr_t", NULL,
+};
+
+static size_t c_comment_end(const char *text, size_t n, size_t i, bool *closed)
+{
+    for (; i + 1 < n; i++)
+        if (text[i] == '*' && text[i+1] == '/')
+        {
+            *closed = true;
+            return i + 2;
+        }
+    *closed = false;
+    return n;
+}
+
+static uint32_t lex_c(const char *text, size_t n, uint32_t state, Tokens *tokens)
+{
+    size_t i = 0;
+    bool closed = true;
+    if (state == C_COMMENT)
+    {
+        emit(tokens, 0, TOKEN_COMMENT);
+        i = c_comment_end(text, n, 0, &closed);
+        if (!closed) return C_COMMENT;
+    }
+    else if (state == C_STRING)
+    {
+        emit(tokens, 0, TOKEN_STRING);
+        i = string_end(text, n, 0, '"', &closed);
+        if (!closed) return n > 0 && text[n-1] == '\\' ? C_STRING : C_CODE;
+    }
+
+    bool lineStart = true; // only spaces so far, a '#' starts a directive
+    while (i < n)
+    {
+        if (tokens == NULL)
+        {   // only comments and strings change the state, skip to the next one
+            while (i < n && text[i] != '/' && text[i] != '"' && text[i] != '\'') i++;
+            if (i == n) break;
+        }
+        const char c = text[i];
+        const char next = i + 1 < n ? text[i+1] : '\0';
+        if (c == '/' && next == '/')
+        {
+            emit(tokens, i, TOKEN_COMMENT);
+            return C_CODE;
+        }
+        if (c == '/' && next == '*')
+        {
+            emit(tokens, i, TOKEN_COMMENT);
+            i = c_comment_end(text, n, i + 2, &closed);
+            if (!closed) return C_COMMENT;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            emit(tokens, i, TOKEN_STRING);
+            i = string_end(text, n, i + 1, c, &closed);
+            // a string only goes on on the next line after a '\'
+            if (!closed && c == '"' && text[n-1] == '\\') return C_STRING;
+        }
+        else if (c == '#' && lineStart)
+        {
+            size_t j = i + 1;
+            while (j < n && text[j] == ' ') j++;
+            emit(tokens, i, TOKEN_PREPROC);
+            i = word_end(text, n, j);
+        }
+        else if (is_digit(c) || (c == '.' && is_digit(next)))
+        {
+            emit(tokens, i, TOKEN_NUMBER);
+            i = number_end(text, n, i);
+        }
+        else if (is_word_start(c))
+        {
+            const size_t j = word_end(text, n, i);
+            if (tokens != NULL)
+            {
+                TokenKind kind = TOKEN_TEXT;
+                if (word_in(text + i, j - i, cKeywords)) kind = TOKEN_KEYWORD;
+                else if (word_in(text + i, j - i, cTypes)) kind = TOKEN_TYPE;
+                emit(tokens, i, kind);
+            }
+            i = j;
+        }
+        else
+        {
+            emit(tokens, i, TOKEN_TEXT);
+            i++;
+        }
+        lineStart = lineStart && (c == ' ' || c == '\t');
+    }
+    return C_CODE;
+}
+
+// ---------------------------------------------------------------------------
+// Python
+
+enum { PY_CODE, PY_TRIPLE_DOUBLE, PY_TRIPLE_SINGLE };
+
+static const char *const pyKeywords[] = {
+    "and", "as", "assert", "async", "await", "break", "class", "continue",
+    "def", "del", "elif", "else", "except", "finally", "for", "from", "global",
+    "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass",
+    "raise", "return", "try", "while", "with", "yield", "True", "False",
+    "None", NULL,
+};
+
+static const char *const pyTypes[] = {
+    "int", "float", "complex", "str", "bytes", "bool", "list", "tuple",
+    "dict", "set", "frozenset", "object", "type", "self", "cls", NULL,
+};
+
+static size_t py_triple_end(const char *text, size_t n, size_t i, char quote, bool *closed)
+{
+    for (; i < n; i++)
+    {
+        if (text[i] == '\\') { i++; continue; }
+        if (i + 2 < n && text[i] == quote && text[i+1] == quote && text[i+2] == quote)
+        {
+            *closed = true;
+            return i + 3;
+        }
+    }
+    *closed = false;
+    return n;
+}
+
+static bool py_string_prefix(const char *text, size_t n)
+{
+    if (n > 2) return false;
+    for (size_t i=0; i<n; i++)
+        if (!strchr("rRbBfFuU", text[i])) return false;
+    return true;
+}
+
+static uint32_t lex_python(const char *text, size_t n, uint32_t state, Tokens *tokens)
+{
+    size_t i = 0;
+    bool closed = true;
+    if (state == PY_TRIPLE_DOUBLE || state == PY_TRIPLE_SINGLE)
+    {
+        emit(tokens, 0, TOKEN_STRING);
+        i = py_triple_end(text, n, 0, state == PY_TRIPLE_DOUBLE ? '"' : '\'', &closed);
+        if (!closed) return state;
+    }
+
+    while (i < n)
+    {
+        if (tokens == NULL)
+        {   // only comments and strings change the state, skip to the next one
+            while (i < n && text[i] != '#' && text[i] != '"' && text[i] != '\'') i++;
+            if (i == n) break;
+        }
+        const char c = text[i];
+        const char next = i + 1 < n ? text[i+1] : '\0';
+        if (c == '#')
+        {
+            emit(tokens, i, TOKEN_COMMENT);
+            return PY_CODE;
+        }
+        if (c == '"' || c == '\'')
+        {
+            emit(tokens, i, TOKEN_STRING);
+            if (i + 2 < n && next == c && text[i+2] == c)
+            {
+                i = py_triple_end(text, n, i + 3, c, &closed);
+                if (!closed) return c == '"' ? PY_TRIPLE_DOUBLE : PY_TRIPLE_SINGLE;
+            }
+            else
+            {
+                i = string_end(text, n, i + 1, c, &closed);
+            }
+        }
+        else if (c == '@')
+        {
+            emit(tokens, i, TOKEN_PREPROC);
+            i = word_end(text, n, i + 1);
+        }
+        else if (is_digit(c) || (c == '.' && is_digit(next)))
+        {
+            emit(tokens, i, TOKEN_NUMBER);
+            i = number_end(text, n, i);
+        }
+        else if (is_word_start(c))
+        {
+            const size_t j = word_end(text, n, i);
+            if (j < n && (text[j] == '"' || text[j] == '\'') && py_string_prefix(text + i, j - i))
+            {   // r"...", b'...', f"..." and friends
+                emit(tokens, i, TOKEN_STRING);
+                i = j;
+                continue;
+            }
+            if (tokens != NULL)
+            {
+                TokenKind kind = TOKEN_TEXT;
+                if (word_in(text + i, j - i, pyKeywords)) kind = TOKEN_KEYWORD;
+                else if (word_in(text + i, j - i, pyTypes)) kind = TOKEN_TYPE;
+                emit(tokens, i, kind);
+            }
+            i = j;
+        }
+        else
+        {
+            emit(tokens, i, TOKEN_TEXT);
+            i++;
+        }
+    }
+    return PY_CODE;
+}
+
+// ---------------------------------------------------------------------------
+// JSON, nothing spans lines so the state is always 0
+
+static uint32_t lex_json(const char *text, size_t n, uint32_t state, Tokens *tokens)
+{
+    (void)state;
+    if (tokens == NULL) return 0;
+
+    for (size_t i=0; i<n;)
+    {
+        const char c = text[i];
+        if (c == '"')
+        {
+            bool closed;
+            const size_t j = string_end(text, n, i + 1, '"', &closed);
+            // keys are told apart from values by the ':' after them
+            size_t k = j;
+            while (k < n && (text[k] == ' ' || text[k] == '\t')) k++;
+            emit(tokens, i, k < n && text[k] == ':' ? TOKEN_KEYWORD : TOKEN_STRING);
+            i = j;
+        }
+        else if (is_digit(c) || c == '-')
+        {
+            emit(tokens, i, TOKEN_NUMBER);
+            i = number_end(text, n, i);
+        }
+        else if (is_word_start(c))
+        {
+            const size_t j = word_end(text, n, i);
+            static const char *const constants[] = { "true", "false", "null", NULL };
+            emit(tokens, i, word_in(text + i, j - i, constants) ? TOKEN_TYPE : TOKEN_TEXT);
+            i = j;
+        }
+        else
+        {
+            emit(tokens, i, TOKEN_TEXT);
+            i++;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+static const Language languages[] = {
+    { "C",      ".c .h .cc .cpp .hpp", lex_c      },
+    { "Python", ".py .pyw",            lex_python },
+    { "JSON",   ".json",               lex_json   },
+};
+
+const Language *syntax_find_language(const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+    if (ext == NULL) return NULL;
+    const size_t len = strlen(ext);
+
+    for (size_t i=0; i<sizeof(languages)/sizeof(languages[0]); i++)
+    {
+        for (const char *e = languages[i].extensions; *e != '\0';)
+        {
+            size_t n = strcspn(e, " ");
+            if (n == len && memcmp(e, ext, n) == 0) return &languages[i];
+            e += n;
+            while (*e == ' ') e++;
+        }
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Worker
+
+static void text_append(SyntaxText *t, const char *text, size_t n)
+{
+    if (t->size < t->count + n) da_reserve(t, (t->count + n)*2);
+    memcpy(t->items + t->count, text, n);
+    t->count += n;
+}
+
+// walks the lines of a snapshot of the pieces
+typedef struct {
+    const Piece *pieces;
+    size_t       count;
+    size_t       piece;
+    size_t       offset;
+    bool         finished;
+    SyntaxText   line; // lines spanning pieces get copied here
+} SnapshotReader;
+
+static void snapshot_start(SnapshotReader *r, const Piece *pieces, size_t count, size_t pos)
+{
+    r->pieces = pieces;
+    r->count = count;
+    r->piece = 0;
+    r->finished = false;
+    while (r->piece < count && pos >= pieces[r->piece].len)
+        pos -= pieces[r->piece++].len;
+    r->offset = pos;
+}
+
+// next line without its '\n', false after the last one
+static bool snapshot_line(SnapshotReader *r, const char **text, size_t *n)
+{
+    if (r->finished) return false;
+    const char *span = "";
+    size_t spanLen = 0;
+    bool copied = false;
+    bool newline = false;
+    r->line.count = 0;
+
+    while (!newline && r->piece < r->count)
+    {
+        const Piece *p = &r->pieces[r->piece];
+        const char *chunk = p->data + r->offset;
+        const size_t len = p->len - r->offset;
+        const size_t end = scan_newline(chunk, len);
+        newline = end < len;
+
+        r->offset += newline ? end + 1 : len;
+        if (r->offset == p->len)
+        {
+            r->piece++;
+            r->offset = 0;
+        }
+
+        if (!copied && spanLen == 0)
+        {
+            span = chunk;
+            spanLen = end;
+        }
+        else
+        {   // the line goes on in another piece
+            if (!copied) text_append(&r->line, span, spanLen);
+            text_append(&r->line, chunk, end);
+            copied = true;
+        }
+    }
+    // the text ended without a '\n', that was the last line
+    if (!newline) r->finished = true;
+
+    *text = copied ? r->line.items : span;
+    *n = copied ? r->line.count : spanLen;
+    return true;
+}
+
+static void *syntax_worker(void *arg)
+{
+    SyntaxWorker *w = arg;
+    Pieces pieces = {0};
+    SnapshotReader r = {0};
+    uint32_t batch[SYNTAX_BATCH];
+
+    pthread_mutex_lock(&w->lock);
+    for (;;)
+    {
+        while (!w->pending && !w->quit) pthread_cond_wait(&w->wake, &w->lock);
+        if (w->quit) break;
+
+        // take the job over, the editor is free to post the next one
+        w->pending = false;
+        w->running = true;
+        const size_t generation = w->jobGeneration;
+        const Language *lang = w->lang;
+        uint32_t state = w->startState;
+        da_reserve(&pieces, w->pieces.count);
+        memcpy(pieces.items, w->pieces.items, w->pieces.count*sizeof(Piece));
+        pieces.count = w->pieces.count;
+        snapshot_start(&r, pieces.items, pieces.count, w->startPos);
+        pthread_mutex_unlock(&w->lock);
+
+        bool done = false;
+        while (!done && atomic_load(&w->generation) == generation)
+        {
+            size_t count = 0;
+            const char *text;
+            size_t n;
+            while (count < SYNTAX_BATCH && snapshot_line(&r, &text, &n))
+                batch[count++] = state = lang->lex(text, n, state, NULL);
+            done = count < SYNTAX_BATCH;
+
+            bool notify = false;
+            pthread_mutex_lock(&w->lock);
+            if (atomic_load(&w->generation) == generation)
+            {
+                SyntaxStates *states = &w->states;
+                if (states->size < states->count + count) da_reserve(states, (states->count + count)*2);
+                memcpy(states->items + states->count, batch, count*sizeof(uint32_t));
+                states->count += count;
+                w->done = done;
+                notify = w->notify != NULL && !w->notified;
+                w->notified = true;
+            }
+            pthread_mutex_unlock(&w->lock);
+            if (notify) w->notify();
+        }
+
+        pthread_mutex_lock(&w->lock);
+        w->running = false;
+        pthread_cond_broadcast(&w->idle);
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    da_free(&pieces);
+    da_free(&r.line);
+    return NULL;
+}
+
+// drops the job, the worker notices it after its current batch
+static void syntax_cancel(Syntax *s)
+{
+    atomic_fetch_add(&s->worker.generation, 1);
+    s->jobActive = false;
+}
+
+// hands the lines from the frontier on to the worker
+static void syntax_post(Syntax *s, Buffer *b, Lines *l)
+{
+    SyntaxWorker *w = &s->worker;
+    if (!w->started)
+    {   // without a thread the frontier just moves on a bit every update
+        w->started = pthread_create(&w->thread, NULL, syntax_worker, w) == 0;
+        if (!w->started) return;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    w->jobGeneration = atomic_fetch_add(&w->generation, 1) + 1;
+    w->pending = true;
+    w->lang = s->lang;
+    // piece data never changes until the buffer is freed, copying the
+    // pieces is enough for a snapshot
+    da_reserve(&w->pieces, b->pieces.count);
+    memcpy(w->pieces.items, b->pieces.items, b->pieces.count*sizeof(Piece));
+    w->pieces.count = b->pieces.count;
+    w->startRow = s->frontier;
+    w->startPos = lines_get(l, s->frontier).start;
+    w->startState = s->frontier > 0 ? lines_get_state(l, s->frontier - 1) : 0;
+    w->states.count = 0;
+    w->done = false;
+    w->notified = false;
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    s->jobActive = true;
+    s->applied = 0;
+}
+
+// copies the states the worker found for the lines before `end` into the
+// index and moves the frontier past them
+static void syntax_take(Syntax *s, Lines *l, size_t end)
+{
+    SyntaxWorker *w = &s->worker;
+    pthread_mutex_lock(&w->lock);
+    w->notified = false;
+    size_t count = w->states.count;
+    if (end < w->startRow + count) count = end > w->startRow ? end - w->startRow : 0;
+    if (count > s->applied)
+    {   // the lines after the new states were plain text so far
+        lines_set_states(l, w->startRow + s->applied, w->states.items + s->applied, count - s->applied);
+        const size_t from = w->startRow + s->applied + 1;
+        if (from < s->changedFrom) s->changedFrom = from;
+        if (w->startRow + count > s->changedTo) s->changedTo = w->startRow + count;
+        s->applied = count;
+        s->frontier = w->startRow + count;
+        s->tokensValid = false;
+    }
+    const bool finished = w->done && s->applied == w->states.count;
+    pthread_mutex_unlock(&w->lock);
+
+    if (finished)
+    {
+        s->jobActive = false;
+        s->frontier = SIZE_MAX;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+void syntax_init(Syntax *s)
+{
+    *s = (Syntax) {0};
+    da_init(&s->text);
+    da_init(&s->tokens);
+    da_init(&s->worker.pieces);
+    da_init(&s->worker.states);
+    pthread_mutex_init(&s->worker.lock, NULL);
+    pthread_cond_init(&s->worker.wake, NULL);
+    pthread_cond_init(&s->worker.idle, NULL);
+    atomic_init(&s->worker.generation, 0);
+    syntax_set_language(s, NULL);
+}
+
+void syntax_free(Syntax *s)
+{
+    SyntaxWorker *w = &s->worker;
+    syntax_stop(s);
+    if (w->started)
+    {
+        pthread_mutex_lock(&w->lock);
+        w->quit = true;
+        pthread_cond_signal(&w->wake);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+    }
+    pthread_cond_destroy(&w->idle);
+    pthread_cond_destroy(&w->wake);
+    pthread_mutex_destroy(&w->lock);
+    da_free(&w->pieces);
+    da_free(&w->states);
+    da_free(&s->text);
+    da_free(&s->tokens);
+}
+
+void syntax_set_language(Syntax *s, const Language *lang)
+{
+    syntax_cancel(s);
+    s->lang = lang;
+    s->frontier = 0;
+    s->dirtyTo = SIZE_MAX; // nothing can be trusted to converge
+    s->changedFrom = SIZE_MAX;
+    s->changedTo = 0;
+    s->tokensValid = false;
+}
+
+void syntax_stop(Syntax *s)
+{
+    SyntaxWorker *w = &s->worker;
+    syntax_cancel(s);
+    if (!w->started) return;
+
+    pthread_mutex_lock(&w->lock);
+    w->pending = false;
+    while (w->running) pthread_cond_wait(&w->idle, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+bool syntax_busy(Syntax *s)
+{
+    if (s->jobActive) return true;
+    if (!s->worker.started) return false;
+    // a cancelled job runs until the end of its batch
+    pthread_mutex_lock(&s->worker.lock);
+    const bool running = s->worker.running;
+    pthread_mutex_unlock(&s->worker.lock);
+    return running;
+}
+
+// where `row` ended up after an edit at `from` changed the line count by `shift`
+static size_t syntax_shift(size_t row, size_t from, ptrdiff_t shift)
+{
+    if (row == SIZE_MAX || row <= from) return row;
+    if (shift < 0 && (size_t)-shift > row - from) return from;
+    return row + shift;
+}
+
+void syntax_edit(Syntax *s, Lines *l, size_t from, size_t to, ptrdiff_t shift)
+{
+    if (s->jobActive)
+    {   // what the worker found before the edit still holds
+        syntax_take(s, l, from);
+        syntax_cancel(s);
+    }
+
+    s->tokensValid = false;
+    if (s->frontier == SIZE_MAX)
+    {
+        s->frontier = from;
+        s->dirtyTo = to;
+        return;
+    }
+
+    s->dirtyTo = syntax_shift(s->dirtyTo, from, shift);
+    if (from < s->frontier)
+    {   // the states from the old frontier on were lexed from another start
+        // state, they can not be trusted to converge either
+        const size_t frontier = syntax_shift(s->frontier, from, shift);
+        if (frontier > s->dirtyTo) s->dirtyTo = frontier;
+        s->frontier = from;
+    }
+    if (to > s->dirtyTo) s->dirtyTo = to;
+}
+
+// text of line `row`, copied only when it spans pieces
+static const char *syntax_line_text(Syntax *s, Buffer *b, Lines *l, size_t row, size_t *n)
+{
+    const Line line = lines_get(l, row);
+    *n = line.end - line.start;
+    if (*n == 0) return "";
+
+    size_t len;
+    const char *chunk = buffer_chunk(b, line.start, &len);
+    if (len >= *n) return chunk;
+    da_reserve(&s->text, *n);
+    buffer_copy(b, line.start, *n, s->text.items);
+    return s->text.items;
+}
+
+size_t syntax_update(Syntax *s, Buffer *b, Lines *l, size_t end)
+{
+    if (s->jobActive)
+    {
+        syntax_take(s, l, SIZE_MAX);
+        return 0;
+    }
+    if (s->lang == NULL || s->frontier >= l->count) return 0;
+    if (end > l->count) end = l->count;
+    if (end <= s->frontier) return 0;
+
+    // past the budget the worker takes over
+    const size_t stop = end - s->frontier > SYNTAX_SYNC_LINES ? s->frontier + SYNTAX_SYNC_LINES : end;
+    size_t row = s->frontier;
+    uint32_t state = row > 0 ? lines_get_state(l, row - 1) : 0;
+    for (; row < stop; row++)
+    {
+        size_t n;
+        const char *text = syntax_line_text(s, b, l, row, &n);
+        const uint32_t old = lines_get_state(l, row);
+        state = s->lang->lex(text, n, state, NULL);
+        if (state != old)
+        {   // the next line starts in another state, its colors change
+            lines_set_state(l, row, state);
+            if (row + 1 < s->changedFrom) s->changedFrom = row + 1;
+            if (row + 1 > s->changedTo) s->changedTo = row + 1;
+            s->tokensValid = false;
+        }
+        else if (row >= s->dirtyTo)
+        {   // converged, the lines after this one are lexed the same as before
+            row++;
+            const size_t lexed = row - s->frontier;
+            s->frontier = SIZE_MAX;
+            return lexed;
+        }
+    }
+    const size_t lexed = row - s->frontier;
+    s->frontier = row < l->count ? row : SIZE_MAX;
+    if (s->frontier < end) syntax_post(s, b, l);
+    return lexed;
+}
+
+const Tokens *syntax_line(Syntax *s, Buffer *b, Lines *l, size_t row)
+{
+    if (s->tokensValid && s->tokensRow == row) return &s->tokens;
+
+    s->tokens.count = 0;
+    if (s->lang != NULL && row <= s->frontier)
+    {
+        size_t n;
+        const char *text = syntax_line_text(s, b, l, row, &n);
+        s->lang->lex(text, n, row > 0 ? lines_get_state(l, row - 1) : 0, &s->tokens);
+    }
+    s->tokensRow = row;
+    s->tokensValid = true;
+    return &s->tokens;
+}
@@ -0,0 +1,159 @@
+#pragma once
+/*
+ * Syntax highlighting
+ *
+ * A language is just a function lexing one line: it gets the state the
+ * previous line ended in (inside a block comment, a multi-line string, ...),
+ * appends the tokens of the line and returns the state at its end. Adding a
+ * language means writing that function and adding it to the table in
+ * syntax.c.
+ *
+ * The end state of every line is kept in the line index. After an edit the
+ * lines are lexed again from the edited one until a line ends in the same
+ * state as before, the lines after that keep their colors. Only the states
+ * are computed up to the viewport, tokens are made for the drawn lines only.
+ *
+ * An update lexes at most SYNTAX_SYNC_LINES lines on the calling thread,
+ * anything further (opening a big file, jumping to its end) is handed to a
+ * worker thread lexing a snapshot of the pieces. Its states are copied into
+ * the line index as they come in, lines it has not reached yet are shown
+ * as plain text. An edit cancels the worker, keeping what it found for the
+ * lines before the edit. The worker can wake the event loop through
+ * `notify` whenever it brought in states, instead of the loop polling.
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "buffer.h"
+#include "line_index.h"
+
+typedef enum {
+    TOKEN_TEXT,
+    TOKEN_KEYWORD,
+    TOKEN_TYPE,
+    TOKEN_STRING,
+    TOKEN_NUMBER,
+    TOKEN_COMMENT,
+    TOKEN_PREPROC,
+    TOKEN_COUNT,
+} TokenKind;
+
+typedef struct {
+    size_t    start; // offset in the line, the token runs up to the next one
+    TokenKind kind;
+} Token;
+
+typedef struct {
+    Token *items;
+    size_t size;
+    size_t count;
+} Tokens;
+
+// lexes one line of `n` bytes (without the '\n') starting in `state` and
+// returns the state at its end, `tokens` is NULL when only that is needed
+typedef uint32_t (*LexLine)(const char *text, size_t n, uint32_t state, Tokens *tokens);
+
+typedef struct {
+    const char *name;
+    const char *extensions; // space separated, ".c .h"
+    LexLine     lex;
+} Language;
+
+typedef struct {
+    char  *items;
+    size_t size;
+    size_t count;
+} SyntaxText;
+
+#define SYNTAX_SYNC_LINES 2048
+
+typedef struct {
+    uint32_t *items;
+    size_t size;
+    size_t count;
+} SyntaxStates;
+
+typedef struct {
+    pthread_t       thread;
+    bool            started;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake; // a job got posted, or the worker has to quit
+    pthread_cond_t  idle; // the worker stopped reading its snapshot
+
+    // bumped for every job and to cancel one, the worker drops its results
+    // as soon as it does not match the job's anymore
+    atomic_size_t generation;
+
+    // the job, set by the editor under the lock
+    size_t          jobGeneration;
+    bool            pending;
+    bool            quit;
+    const Language *lang;
+    Pieces          pieces;     // snapshot of the buffer
+    size_t          startPos;   // where line startRow starts
+    size_t          startRow;
+    uint32_t        startState; // end state of the line before it
+
+    // end states of the lines from startRow on, appended by the worker
+    // under the lock
+    SyntaxStates states;
+    bool         running; // reading the snapshot
+    bool         done;    // reached the end of the snapshot
+
+    // called on the worker thread after it appended states, at most once
+    // until they get taken. NULL when nobody needs waking, set before the
+    // first update
+    void (*notify)(void);
+    bool   notified;
+} SyntaxWorker;
+
+typedef struct {
+    const Language *lang; // NULL for plain text
+
+    // end states of the lines before `frontier` are up to date (SIZE_MAX:
+    // all of them), the lines up to `dirtyTo` got edited and are lexed
+    // again even if the state did not change
+    size_t frontier;
+    size_t dirtyTo;
+
+    // lines that changed color without being edited, inclusive, SIZE_MAX and
+    // 0 when none did. Cleared by the caller
+    size_t changedFrom;
+    size_t changedTo;
+
+    SyntaxText text;  // lines spanning pieces get copied here
+    Tokens     tokens;
+    size_t     tokensRow;
+    bool       tokensValid;
+
+    SyntaxWorker worker;
+    bool         jobActive; // the worker lexes from the frontier on
+    size_t       applied;   // states of the job copied into the index
+} Syntax;
+
+// language for the extension of `filename`, NULL if there is none
+const Language *syntax_find_language(const char *filename);
+
+void   syntax_init(Syntax *s);
+void   syntax_free(Syntax *s);
+// lexes everything again, the states in the index are not trusted anymore
+void   syntax_set_language(Syntax *s, const Language *lang);
+// cancels the worker and waits until it let go of its snapshot, needed
+// before the buffer memory gets freed
+void   syntax_stop(Syntax *s);
+// the worker is lexing, updates may bring in new states (or it is still
+// finishing a cancelled job and allocating)
+bool   syntax_busy(Syntax *s);
+
+// lines [from, to] got edited (rows after the edit), the edit changed the
+// number of lines by `shift`
+void   syntax_edit(Syntax *s, Lines *l, size_t from, size_t to, ptrdiff_t shift);
+// brings the end states of the lines before `end` up to date, or hands them
+// to the worker, and takes in what the worker found so far. Returns the
+// number of lines lexed on the calling thread
+size_t syntax_update(Syntax *s, Buffer *b, Lines *l, size_t end);
+// tokens of line `row`, valid until the next call, no tokens (plain text)
+// while the lines before it are not lexed yet
+const Tokens *syntax_line(Syntax *s, Buffer *b, Lines *l, size_t row);